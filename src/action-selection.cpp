@@ -0,0 +1,117 @@
+#include "action-selection.h"
+
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Qbert {
+
+#ifdef __SSE2__
+
+// Lane masks for each of the 16 possible action masks.
+alignas(16) static const int laneMasks[16][4]{
+    {0, 0, 0, 0},
+    {-1, 0, 0, 0},
+    {0, -1, 0, 0},
+    {-1, -1, 0, 0},
+    {0, 0, -1, 0},
+    {-1, 0, -1, 0},
+    {0, -1, -1, 0},
+    {-1, -1, -1, 0},
+    {0, 0, 0, -1},
+    {-1, 0, 0, -1},
+    {0, -1, 0, -1},
+    {-1, -1, 0, -1},
+    {0, 0, -1, -1},
+    {-1, 0, -1, -1},
+    {0, -1, -1, -1},
+    {-1, -1, -1, -1}};
+
+// Selects a where the lane mask is set and b elsewhere.
+static inline __m128i select(__m128i laneMask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(
+        _mm_and_si128(laneMask, a), _mm_andnot_si128(laneMask, b));
+}
+
+ActionSelection
+    selectActions(const float* utilities, const int* visited, int mask)
+{
+    auto laneMask =
+        _mm_load_si128(reinterpret_cast<const __m128i*>(laneMasks[mask]));
+
+    // Invalid actions read as -infinity for the maximum utility, and as the
+    // largest integer for the minimum visit count.
+    auto u = _mm_castsi128_ps(select(
+        laneMask,
+        _mm_castps_si128(_mm_load_ps(utilities)),
+        _mm_castps_si128(
+            _mm_set1_ps(-std::numeric_limits<float>::infinity()))));
+    auto v = select(
+        laneMask,
+        _mm_load_si128(reinterpret_cast<const __m128i*>(visited)),
+        _mm_set1_epi32(std::numeric_limits<int>::max()));
+
+    // Horizontal maximum and minimum by swapping pairs of lanes, then halves.
+    auto uMax = _mm_max_ps(u, _mm_shuffle_ps(u, u, _MM_SHUFFLE(2, 3, 0, 1)));
+    uMax = _mm_max_ps(
+        uMax, _mm_shuffle_ps(uMax, uMax, _MM_SHUFFLE(1, 0, 3, 2)));
+    auto vSwapped = _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+    auto vMin = select(_mm_cmplt_epi32(v, vSwapped), v, vSwapped);
+    vSwapped = _mm_shuffle_epi32(vMin, _MM_SHUFFLE(1, 0, 3, 2));
+    vMin = select(_mm_cmplt_epi32(vMin, vSwapped), vMin, vSwapped);
+
+    ActionSelection selection;
+    selection.maxUtility = _mm_cvtss_f32(uMax);
+    selection.minVisited = _mm_cvtsi128_si32(vMin);
+    selection.bestMask = _mm_movemask_ps(_mm_cmpeq_ps(u, uMax)) & mask;
+    return selection;
+}
+
+#else
+
+ActionSelection
+    selectActions(const float* utilities, const int* visited, int mask)
+{
+    return selectActionsScalar(utilities, visited, mask);
+}
+
+#endif
+
+ActionSelection
+    selectActionsScalar(const float* utilities, const int* visited, int mask)
+{
+    ActionSelection selection{-std::numeric_limits<float>::infinity(),
+                              std::numeric_limits<int>::max(),
+                              0};
+    for (int i = 0; i < 4; ++i)
+    {
+        if ((mask & (1 << i)) == 0)
+            continue;
+        if (utilities[i] > selection.maxUtility)
+        {
+            selection.maxUtility = utilities[i];
+            selection.bestMask = 0;
+        }
+        if (utilities[i] == selection.maxUtility)
+            selection.bestMask |= 1 << i;
+        if (visited[i] < selection.minVisited)
+            selection.minVisited = visited[i];
+    }
+    return selection;
+}
+
+int countActions(int mask)
+{
+    return __builtin_popcount(mask);
+}
+
+int getNthAction(int mask, int n)
+{
+    for (; n > 0; --n)
+        mask &= mask - 1;
+    return __builtin_ctz(mask);
+}
+}
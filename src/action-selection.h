@@ -0,0 +1,33 @@
+#pragma once
+
+namespace Qbert {
+
+// The result of scanning the valid actions of a state.
+struct ActionSelection
+{
+    // The highest utility among the valid actions.
+    float maxUtility;
+
+    // The lowest visit count among the valid actions.
+    int minVisited;
+
+    // A mask of the valid actions whose utility equals maxUtility.
+    int bestMask;
+};
+
+// Scans the actions of a state in a single pass. The utilities and visit counts
+// are 4-wide rows aligned to 16 bytes, and bit i of the mask is set if action
+// i is valid. The mask must not be empty.
+ActionSelection
+    selectActions(const float* utilities, const int* visited, int mask);
+
+// A scalar version of selectActions, used as a reference for the SIMD one.
+ActionSelection
+    selectActionsScalar(const float* utilities, const int* visited, int mask);
+
+// Returns the number of actions in the mask.
+int countActions(int mask);
+
+// Returns the index of the n-th action in the mask, starting from 0.
+int getNthAction(int mask, int n);
+}
@@ -0,0 +1,115 @@
+#include "actor-learner.h"
+
+#include <algorithm>
+
+#include "learner.h"
+
+namespace Qbert {
+
+void SnapshotChannel::publish(std::shared_ptr<const PolicySnapshot> newSnapshot)
+{
+    long newVersion = newSnapshot->version;
+    std::atomic_store(&snapshot, std::move(newSnapshot));
+    version.store(newVersion, std::memory_order_release);
+}
+
+void SnapshotChannel::refresh(
+    std::shared_ptr<const PolicySnapshot>& current) const
+{
+    if (!current || current->version != version.load(std::memory_order_acquire))
+        current = std::atomic_load(&snapshot);
+}
+
+void SnapshotChannel::setApplied(long transitions)
+{
+    applied.store(transitions, std::memory_order_relaxed);
+}
+
+long SnapshotChannel::getApplied() const
+{
+    return applied.load(std::memory_order_relaxed);
+}
+
+ActorLearnerHub::ActorLearnerHub(
+    std::size_t queueCapacity, long snapshotInterval)
+    : queueCapacity{queueCapacity}, snapshotInterval{snapshotInterval}
+{
+}
+
+ActorLearnerHub::~ActorLearnerHub() = default;
+
+std::pair<std::shared_ptr<TransitionQueue>, const SnapshotChannel*>
+    ActorLearnerHub::connect(
+        const std::string& name,
+        const std::function<std::unique_ptr<Learner>()>& createMaster)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    auto& master = masters[name];
+    if (!master)
+    {
+        master = std::make_unique<Master>();
+        master->learner = createMaster();
+        publish(*master);
+    }
+    auto queue = std::make_shared<TransitionQueue>(queueCapacity);
+    connections.push_back({queue, master.get()});
+    return {queue, &master->channel};
+}
+
+long ActorLearnerHub::drain()
+{
+    long total = 0;
+    for (auto& connection : connections)
+    {
+        auto depth = connection.queue->size();
+        ++depthSamples;
+        depthSum += depth;
+        maxDepth = std::max(maxDepth, depth);
+
+        // We only take the transitions that were waiting when we started, so
+        // that a busy actor can't starve the others.
+        auto& master = *connection.master;
+        Transition transition;
+        for (std::size_t i = 0; i < depth && connection.queue->pop(transition);
+             ++i)
+        {
+            master.learner->applyTransition(transition);
+            ++master.applied;
+            ++total;
+        }
+        master.channel.setApplied(master.applied);
+    }
+    for (auto& p : masters)
+    {
+        auto& master = *p.second;
+        if (master.applied - master.published >= snapshotInterval)
+            publish(master);
+    }
+    return total;
+}
+
+void ActorLearnerHub::save()
+{
+    for (auto& p : masters)
+        p.second->learner->saveToFile();
+}
+
+double ActorLearnerHub::getAverageQueueDepth() const
+{
+    return depthSamples == 0 ? 0 : depthSum / depthSamples;
+}
+
+std::size_t ActorLearnerHub::getMaxQueueDepth() const
+{
+    return maxDepth;
+}
+
+void ActorLearnerHub::publish(Master& master)
+{
+    auto snapshot = std::make_shared<PolicySnapshot>();
+    snapshot->entries = master.learner->createSnapshot();
+    snapshot->version = master.applied;
+    master.published = master.applied;
+    master.channel.publish(std::move(snapshot));
+}
+}
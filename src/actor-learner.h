@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "param-file.h"
+#include "spsc-queue.h"
+
+namespace Qbert {
+
+class Learner;
+
+// A step of Q-learning recorded by an actor. An update moves the learner from
+// state to nextState after taking the given action, and records a visit to
+// nextAction in nextState. A correction assigns an additional reward to the
+// given action in the given state.
+struct Transition
+{
+    enum Type
+    {
+        Update,
+        Correction
+    };
+
+    Type type{Update};
+    int state{-1};
+    int action{0};
+    float reward{0};
+    int nextState{-1};
+    int nextMask{0};
+    int nextAction{0};
+};
+
+using TransitionQueue = SpscQueue<Transition>;
+
+// A read-only copy of a learner's table for the actors.
+struct PolicySnapshot
+{
+    ParamTable entries;
+
+    // The number of transitions applied to the table when the copy was made.
+    long version{0};
+};
+
+// The latest snapshot of a learner's table, published by the learner thread
+// and read by the actors.
+class SnapshotChannel
+{
+    std::shared_ptr<const PolicySnapshot> snapshot;
+    std::atomic<long> version{-1};
+    std::atomic<long> applied{0};
+
+public:
+    // Publishes a new snapshot.
+    void publish(std::shared_ptr<const PolicySnapshot> newSnapshot);
+
+    // Replaces the given snapshot with the latest one if it is out of date.
+    // This only takes a lock when there is a newer snapshot.
+    void refresh(std::shared_ptr<const PolicySnapshot>& current) const;
+
+    // Records that the given number of transitions have been applied.
+    void setApplied(long transitions);
+
+    // Returns the number of transitions applied so far.
+    long getApplied() const;
+};
+
+// Connects the learners of the actor threads to the master learners owned by a
+// single learner thread. Each actor's learner pushes its transitions to a queue
+// of its own, and reads the latest snapshot of its master's table.
+class ActorLearnerHub
+{
+    struct Master
+    {
+        std::unique_ptr<Learner> learner;
+        SnapshotChannel channel;
+        long applied{0};
+        long published{0};
+    };
+
+    struct Connection
+    {
+        std::shared_ptr<TransitionQueue> queue;
+        Master* master;
+    };
+
+    const std::size_t queueCapacity;
+    const long snapshotInterval;
+
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<Master>> masters;
+    std::vector<Connection> connections;
+
+    long depthSamples{0};
+    double depthSum{0};
+    std::size_t maxDepth{0};
+
+public:
+    // Constructs a hub with queues of the given capacity, where each master
+    // publishes a snapshot after the given number of transitions.
+    ActorLearnerHub(std::size_t queueCapacity, long snapshotInterval);
+
+    ~ActorLearnerHub();
+
+    // Connects an actor's learner with the given name to its master, using the
+    // given function to create the master the first time. Returns the queue
+    // for the actor's transitions and the channel for its snapshots.
+    std::pair<std::shared_ptr<TransitionQueue>, const SnapshotChannel*>
+        connect(
+            const std::string& name,
+            const std::function<std::unique_ptr<Learner>()>& createMaster);
+
+    // Applies the transitions waiting in the queues to the masters, and
+    // publishes the snapshots that are due. This should only be called by the
+    // learner thread. Returns the number of transitions applied.
+    long drain();
+
+    // Saves the masters' tables. This should only be called by the learner
+    // thread, or once it has stopped.
+    void save();
+
+    // Returns the average number of transitions waiting in a queue when it was
+    // drained.
+    double getAverageQueueDepth() const;
+
+    // Returns the largest number of transitions waiting in a queue when it was
+    // drained.
+    std::size_t getMaxQueueDepth() const;
+
+private:
+    // Publishes a snapshot of the master's table.
+    static void publish(Master& master);
+};
+}
@@ -0,0 +1,108 @@
+#include "agent-factory.h"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+#include "param-file.h"
+#include "param-merge.h"
+#include "monolithic-agent.h"
+#include "subsumption-agent-2.h"
+#include "lookahead-search.h"
+#include "state-encoding.h"
+
+namespace Qbert {
+
+// Returns the lookahead search for the enemy avoider, if there is one.
+static std::unique_ptr<LookaheadSearch> createLookahead(
+    ALEInterface& ale, const Args& args)
+{
+    if (args.lookaheadHops == 0)
+        return nullptr;
+    return std::make_unique<LookaheadSearch>(
+        ale,
+        args.rom,
+        args.randomSeed,
+        args.lookaheadThreads,
+        args.lookaheadHops,
+        std::chrono::microseconds{args.lookaheadBudget});
+}
+
+std::unique_ptr<Agent> createAgent(ALEInterface& ale, const Args& args)
+{
+    std::unique_ptr<Agent> agent;
+    if (args.learner == "monolithic")
+        agent = std::make_unique<MonolithicAgent>(
+            ale,
+            args.learner + "-" + args.explorationPolicy.first,
+            encodeState,
+            args.explorationPolicy.second,
+            args.learnerConfig);
+    else if (args.learner == "subsumption-v1")
+        agent = std::make_unique<SubsumptionAgent2>(
+            ale,
+            args.learner + "-" + args.explorationPolicy.first,
+            getBlockSolverName(args),
+            encodeBlockState,
+            encodeEnemyState,
+            hasEnemiesNearby,
+            args.explorationPolicy.second,
+            args.learnerConfig,
+            createLookahead(ale, args));
+    else if (args.learner == "subsumption-v2")
+        agent = std::make_unique<SubsumptionAgent2>(
+            ale,
+            args.learner + "-" + args.explorationPolicy.first,
+            getBlockSolverName(args),
+            encodeBlockState,
+            encodeEnemyStateWithSeparateCoily,
+            hasEnemiesNearbyWithSeparateCoily,
+            args.explorationPolicy.second,
+            args.learnerConfig,
+            createLookahead(ale, args));
+    else if (args.learner == "subsumption-v3")
+        agent = std::make_unique<SubsumptionAgent2>(
+            ale,
+            args.learner + "-" + args.explorationPolicy.first,
+            getBlockSolverName(args),
+            encodeBlockState,
+            encodeEnemyStateWithSeparateCoilyV2,
+            hasEnemiesNearbyWithSeparateCoilyV2,
+            args.explorationPolicy.second,
+            args.learnerConfig,
+            createLookahead(ale, args));
+    else
+        throw ArgsError{"invalid learner"};
+    agent->setActionRepeat(args.actionRepeat);
+    return agent;
+}
+
+std::string getBlockSolverName(const Args& args)
+{
+    const auto& policy = args.explorationPolicy.first;
+    if (!args.sharedBlockSolver)
+        return args.learner + "-" + policy + "-block-solver";
+
+    // All the subsumption learners encode the block solver's states in the
+    // same way, so the shared table starts from their combined experience.
+    // Each learner then trains a copy of its own, so that runs of different
+    // learners don't overwrite each other's saves.
+    auto name = args.learner + "-" + policy + "-shared-block-solver";
+    if (!paramFileExists(name))
+    {
+        // A frozen learner never writes its tables.
+        if (args.learnerConfig.frozen)
+            throw std::runtime_error{"the table " + name +
+                                     " has not been created yet"};
+        int merged = mergeParamFiles(
+            {"params/subsumption-v1-" + policy + "-block-solver.param",
+             "params/subsumption-v2-" + policy + "-block-solver.param",
+             "params/subsumption-v3-" + policy + "-block-solver.param"},
+            "params/" + name + ".param");
+        if (merged > 0)
+            std::cout << "Merged " << merged << " block solver tables into "
+                      << name << "." << std::endl;
+    }
+    return name;
+}
+}
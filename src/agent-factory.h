@@ -0,0 +1,22 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <ale/ale_interface.hpp>
+
+#include "agent.h"
+#include "args.h"
+
+namespace Qbert {
+
+// Creates the agent given by the arguments for the given ALE instance.
+std::unique_ptr<Agent> createAgent(ALEInterface& ale, const Args& args);
+
+// Returns the name of the block solver's table for the subsumption learners.
+// With args.sharedBlockSolver, each learner has a table of its own that is
+// created by merging the block solver tables of all of them, unless it exists
+// already. A frozen learner throws if the table doesn't exist, since it never
+// writes tables.
+std::string getBlockSolverName(const Args& args);
+}
@@ -1,6 +1,8 @@
 #include "agent.h"
 
 #include <cmath>
+#include <chrono>
+#include <stdexcept>
 
 #include "game-entity.h"
 
@@ -10,62 +12,101 @@ Agent::Agent(ALEInterface& ale) : ale{ale}
 {
 }
 
-void Agent::updateState()
+int Agent::updateState()
 {
-    auto screen = ale.getScreen();
-    auto state = getState(ale);
-    update(state, screen);
+    observe();
+    decide();
+    return act();
+}
 
-    float currentReward = ale.act(action);
-    reward += currentReward;
-    score += currentReward;
-    highScore = std::max(highScore, score);
-    if (ale.lives() < lives)
-        reward -= 1000; // We assign an arbitrary negative reward to deaths.
-    lives = ale.lives();
+void Agent::setActionRepeat(int frames)
+{
+    actionRepeat = frames;
 }
 
-void Agent::update(const StateType& state, const ALEScreen& screen)
+void Agent::observe()
 {
+    auto screen = ale.getScreen();
+    state = getState(ale);
     action = Action::PLAYER_A_NOOP;
     positionTracker = getPlayerPosition(state);
+    isDecisionFrame = false;
+    levelStarted = false;
 
-    // The combination of the first byte in RAM being 0 and the last bit in RAM
-    // being 1 is a good signal for the game accepting actions from the player.
-    auto ram = ale.getRAM();
-    if (ram.get(0x00) == 0 && (ram.get(0x7F) & 0x01) == 1)
+    if (isAcceptingAction(ale))
     {
         updateColors(state, screen, reward);
         if (levelUp)
-        {
             reward = 0;
-        }
         else
-        {
-            action =
-                getAction(positionTracker, state, startColor, goalColor, level);
-            if (positionTracker != playerPosition)
-            {
-                playerPosition = positionTracker;
-                update(
-                    playerPosition,
-                    state,
-                    action,
-                    reward,
-                    startColor,
-                    goalColor,
-                    level);
-                reward = 0;
-            }
-            else
-            {
-                correctUpdate(reward);
-                reward = 0;
-            }
-        }
+            isDecisionFrame = true;
+    }
+    if (isDecisionFrame)
+        encode(positionTracker, state, startColor, goalColor, level);
+}
+
+void Agent::prefetch()
+{
+    if (isDecisionFrame)
+        prefetchRows();
+}
+
+void Agent::decide()
+{
+    if (!isDecisionFrame)
+        return;
+
+    ++decisionCount;
+    action = getAction();
+    if (positionTracker != playerPosition)
+    {
+        playerPosition = positionTracker;
+        update(action, reward);
+        reward = 0;
+    }
+    else
+    {
+        correctUpdate(reward);
+        reward = 0;
     }
 }
 
+int Agent::act()
+{
+    if (isDecisionFrame)
+        prefetchSuccessors(
+            positionTracker, state, startColor, goalColor, level);
+
+    // The frames on which the game doesn't accept an action don't change the
+    // state of the agent other than through their rewards, so they can be
+    // played without looking at the screen. The rewards stay pending until
+    // the next decision, as they would have frame by frame.
+    int frames = 0;
+    do
+    {
+        playFrame();
+        ++frames;
+    } while (frames < actionRepeat && !ale.game_over() &&
+             !isAcceptingAction(ale));
+    return frames;
+}
+
+void Agent::playFrame()
+{
+    auto start = std::chrono::steady_clock::now();
+    float currentReward = ale.act(action);
+    emulatorSeconds += std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+    ++frameCount;
+    reward += currentReward;
+    score += currentReward;
+    highScore = std::max(highScore, score);
+    if (ale.lives() < lives)
+        reward -= 1000; // We assign an arbitrary negative reward to deaths.
+    lives = ale.lives();
+}
+
 void Agent::updateColors(
     const StateType& state, const ALEScreen& screen, float reward)
 {
@@ -77,6 +118,7 @@ void Agent::updateColors(
             correctUpdate(-100);
         levelUp = false;
         ++level;
+        levelStarted = true;
     }
 
     Color color = getGoalColor(screen);
@@ -122,6 +164,9 @@ void Agent::resetGame()
     action = Action::PLAYER_A_NOOP;
     playerPosition = {0, 0};
     positionTracker = {0, 0};
+    frameCount = 0;
+    decisionCount = 0;
+    emulatorSeconds = 0;
 }
 
 float Agent::getScore()
@@ -133,4 +178,103 @@ float Agent::getHighScore()
 {
     return highScore;
 }
+
+int Agent::getFrameCount()
+{
+    return frameCount;
+}
+
+int Agent::getDecisionCount()
+{
+    return decisionCount;
+}
+
+double Agent::getEmulatorSeconds()
+{
+    return emulatorSeconds;
+}
+
+int Agent::getLevel()
+{
+    return level;
+}
+
+bool Agent::hasLevelStarted()
+{
+    return levelStarted;
+}
+
+bool Agent::hasDecided()
+{
+    return isDecisionFrame;
+}
+
+std::uint64_t Agent::getCell() const
+{
+    std::uint64_t blocks = 0;
+    for (int x = 0; x < 8; ++x)
+    {
+        for (int y = 0; y < 8; ++y)
+        {
+            if (state.first[x][y] != GameEntity::Void &&
+                state.second[x][y] == goalColor)
+                blocks |= std::uint64_t{1} << (x * 8 + y);
+        }
+    }
+    // The other fields are mixed in with the steps of an FNV-1a hash.
+    std::uint64_t hash = blocks;
+    for (int value : {positionTracker.first, positionTracker.second, level})
+        hash = (hash ^ static_cast<std::uint64_t>(value)) * 0x100000001b3;
+    return hash;
+}
+
+void Agent::saveState(std::ostream& os) const
+{
+    saveProgress(os);
+    os << highScore << std::endl;
+}
+
+void Agent::restoreState(std::istream& is)
+{
+    restoreProgress(is);
+    is >> highScore;
+    if (!is)
+        throw std::runtime_error{"invalid agent state"};
+}
+
+void Agent::saveProgress(std::ostream& os) const
+{
+    os << startColor << " " << goalColor << " " << levelUpCounter << " "
+       << levelUp << " " << level << " " << lives << " " << reward << " "
+       << score << " " << action << " " << playerPosition.first << " "
+       << playerPosition.second << " " << positionTracker.first << " "
+       << positionTracker.second << std::endl;
+}
+
+void Agent::restoreProgress(std::istream& is)
+{
+    int savedAction;
+    is >> startColor >> goalColor >> levelUpCounter >> levelUp >> level >>
+        lives >> reward >> score >> savedAction >> playerPosition.first >>
+        playerPosition.second >> positionTracker.first >>
+        positionTracker.second;
+    if (!is)
+        throw std::runtime_error{"invalid agent progress"};
+    action = static_cast<Action>(savedAction);
+    highScore = std::max(highScore, score);
+}
+
+int updateStates(const std::vector<Agent*>& agents)
+{
+    for (auto agent : agents)
+        agent->observe();
+    for (auto agent : agents)
+        agent->prefetch();
+    for (auto agent : agents)
+        agent->decide();
+    int frames = 0;
+    for (auto agent : agents)
+        frames += agent->act();
+    return frames;
+}
 }
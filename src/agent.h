@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <utility>
+#include <vector>
+#include <string>
+#include <iostream>
 
 #include <ale/ale_interface.hpp>
 
@@ -20,6 +24,7 @@ class Agent
     int levelUpCounter{0};
     bool levelUp{true};
     int level{-1};
+    bool levelStarted{false};
 
     int lives{0};
     float reward{0};
@@ -29,14 +34,51 @@ class Agent
     std::pair<int, int> playerPosition{0, 0};
     std::pair<int, int> positionTracker{0, 0};
 
+    StateType state;
+    bool isDecisionFrame{false};
+
+    int actionRepeat{1};
+    int frameCount{0};
+    int decisionCount{0};
+    double emulatorSeconds{0};
+
 public:
     // Contructs an agent with a reference to the current ALE instance.
     Agent(ALEInterface& ale);
 
     virtual ~Agent() = default;
 
-    // Updates the state of the game. This should be called every frame.
-    void updateState();
+    // Updates the state of the game. This should be called every frame, or
+    // every few frames with an action repeat. Returns the number of frames
+    // played.
+    int updateState();
+
+    // Sets the number of frames that each action is repeated for. A repeated
+    // action stops early once the game accepts a new action, so that no
+    // decision is skipped.
+    void setActionRepeat(int frames);
+
+    // The steps of an update, in order. Several agents can be updated in
+    // lockstep by taking each step for all of them before the next one. The
+    // prefetch step is left out of updateState, since a single game has no
+    // other work to hide the memory latency behind.
+
+    // Extracts the state of the game from the screen and checks if the game
+    // is accepting an action from the player, in which case the state is
+    // encoded for the learners.
+    void observe();
+
+    // Prefetches the table rows needed to decide on an action, if any.
+    void prefetch();
+
+    // Updates the learners and chooses the next action, if the game is
+    // accepting one.
+    void decide();
+
+    // Sends the chosen action to the game, prefetching the table rows of the
+    // states that it could lead to while the emulator plays it. Returns the
+    // number of frames played.
+    int act();
 
     // Resets the agent after a game over.
     virtual void resetGame();
@@ -47,34 +89,91 @@ public:
     // Returns the best score seen so far.
     float getHighScore();
 
+    // Returns the number of frames played in the current game. The frame and
+    // decision counts and the emulator time start over when a game is
+    // resumed from a checkpoint.
+    int getFrameCount();
+
+    // Returns the number of frames in the current game on which the learners
+    // were asked for an action.
+    int getDecisionCount();
+
+    // Returns the time spent by the emulator on the current game, in seconds.
+    double getEmulatorSeconds();
+
+    // Returns the current level, starting at 0, or -1 before the first level
+    // starts.
+    int getLevel();
+
+    // Returns true if a level started during the last update.
+    bool hasLevelStarted();
+
+    // Returns true if the learners chose an action during the last update.
+    bool hasDecided();
+
+    // Returns a hash of the situation in the last update: the level, the
+    // position of Qbert and the blocks that have reached the goal color.
+    std::uint64_t getCell() const;
+
     // Returns the fraction of random actions taken.
     virtual float getRandomFraction() = 0;
 
+    // Returns named statistics about the learners for the current game.
+    virtual std::vector<std::pair<std::string, float>> getStatistics() = 0;
+
+    // Saves the learners' tables without ending the game.
+    virtual void saveTables() = 0;
+
+    // Writes the state of the current game, apart from the emulator and the
+    // tables, so that the game can be resumed later.
+    virtual void saveState(std::ostream& os) const;
+
+    // Restores the state of the current game written by saveState. The
+    // emulator should be restored to the same point separately.
+    virtual void restoreState(std::istream& is);
+
+    // Writes the progress of the agent through the current game, such as its
+    // level, colors, lives and score, without the state of its learners, so
+    // that another game can be started from the same point.
+    void saveProgress(std::ostream& os) const;
+
+    // Restores the progress written by saveProgress after a reset. The
+    // emulator should be restored to the same point separately.
+    void restoreProgress(std::istream& is);
+
 private:
-    // Updates the learner if the current frame lends itself to updates. This is
-    // done by checking the RAM for when the ALE is accepting actions from the
-    // player that will actually have an effect on the game.
-    void update(const StateType& state, const ALEScreen& screen);
+    // Plays the current action for a single frame and accumulates its reward.
+    void playFrame();
 
     // Updates the start and goal colors.
     void updateColors(
         const StateType& state, const ALEScreen& screen, float reward);
 
-    // Assigns the given reward to the learners.
-    virtual void update(
+    // Encodes the given state for the learners. This is done once per
+    // decision, and the other steps of the decision use the encoded states.
+    virtual void encode(
         std::pair<int, int> position,
         const StateType& state,
-        const Action& actionPerformed,
-        float reward,
         Color startColor,
         Color goalColor,
         int level) = 0;
 
+    // Moves the learners to the encoded state and assigns the given reward to
+    // their last state transition.
+    virtual void update(const Action& actionPerformed, float reward) = 0;
+
     // Assigns an additional reward to the learners without updating the state.
     virtual void correctUpdate(float reward) = 0;
 
-    // Gets the best action from the learners.
-    virtual Action getAction(
+    // Gets the best action in the encoded state from the learners.
+    virtual Action getAction() = 0;
+
+    // Prefetches the rows that the learners read for the encoded state.
+    virtual void prefetchRows() = 0;
+
+    // Prefetches the rows of the states that the moves from the given state
+    // lead to, for the learners that do so.
+    virtual void prefetchSuccessors(
         std::pair<int, int> position,
         const StateType& state,
         Color startColor,
@@ -84,4 +183,10 @@ private:
     // Gets Qbert's position from the state.
     std::pair<int, int> getPlayerPosition(const StateType& state);
 };
+
+// Updates the states of the given agents in lockstep, taking each step of
+// updateState for all of them before the next one. This lets the table rows of
+// all the decisions be fetched at once rather than one game at a time. Returns
+// the number of frames played by all the games.
+int updateStates(const std::vector<Agent*>& agents);
 }
@@ -7,6 +7,40 @@ namespace Qbert {
 std::pair<std::string, ExplorationPolicy> parseExplorationPolicy(
     const std::string& name, int& argIndex, int argc, char** argv);
 
+// Splits a comma-separated list.
+static std::vector<std::string> splitList(const std::string& list)
+{
+    std::vector<std::string> items;
+    std::size_t start = 0;
+    while (true)
+    {
+        auto end = list.find(',', start);
+        items.push_back(list.substr(start, end - start));
+        if (end == std::string::npos)
+            return items;
+        start = end + 1;
+    }
+}
+
+// Parses a comma-separated list of numbers with the given error message.
+static std::vector<float>
+    parseNumbers(const std::string& list, const std::string& error)
+{
+    std::vector<float> numbers;
+    for (const auto& item : splitList(list))
+    {
+        try
+        {
+            numbers.push_back(std::stof(item));
+        }
+        catch (...)
+        {
+            throw ArgsError{error};
+        }
+    }
+    return numbers;
+}
+
 Args parseArgs(int argc, char** argv)
 {
     Args args;
@@ -14,7 +48,14 @@ Args parseArgs(int argc, char** argv)
     for (int i = 1; i < argc; ++i)
     {
         std::string arg{argv[i]};
-        if (arg == "-r" || arg == "--rom")
+        if (arg == "-m" || arg == "--mode")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing mode"};
+            args.mode = argv[i];
+        }
+        else if (arg == "-r" || arg == "--rom")
         {
             ++i;
             if (i == argc)
@@ -51,8 +92,556 @@ Args parseArgs(int argc, char** argv)
             ++i;
             if (i == argc)
                 throw ArgsError{"missing exploration policy"};
+            int nameIndex = i;
             args.explorationPolicy =
                 parseExplorationPolicy(argv[i], i, argc, argv);
+            args.explorationPolicySpec = argv[nameIndex];
+            if (i > nameIndex)
+                args.explorationPolicySpec += std::string{":"} + argv[i];
+        }
+        else if (arg == "--alpha")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing alpha"};
+            try
+            {
+                args.learnerConfig.alpha = std::stof(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing alpha"};
+            }
+            if (args.learnerConfig.alpha <= 0 || args.learnerConfig.alpha > 1)
+                throw ArgsError{"invalid alpha"};
+        }
+        else if (arg == "--gamma")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing gamma"};
+            try
+            {
+                args.learnerConfig.gamma = std::stof(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing gamma"};
+            }
+            if (args.learnerConfig.gamma < 0 || args.learnerConfig.gamma > 1)
+                throw ArgsError{"invalid gamma"};
+        }
+        else if (arg == "--cache_size")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing cache size"};
+            try
+            {
+                args.learnerConfig.cacheSize = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing cache size"};
+            }
+            if (args.learnerConfig.cacheSize < 0 ||
+                args.learnerConfig.cacheSize > LearnerConfig::maxCacheSize)
+                throw ArgsError{"invalid cache size"};
+        }
+        else if (arg == "--max_states")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing maximum number of states"};
+            try
+            {
+                args.learnerConfig.maxStates = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing maximum number of states"};
+            }
+            if (args.learnerConfig.maxStates < 0 ||
+                args.learnerConfig.maxStates > LearnerConfig::maxStatesLimit)
+                throw ArgsError{"invalid maximum number of states"};
+        }
+        else if (arg == "--max_table_mb")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing maximum table size"};
+            try
+            {
+                args.learnerConfig.maxTableMegabytes = std::stof(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing maximum table size"};
+            }
+            // The negated comparison also rejects NaN.
+            if (!(args.learnerConfig.maxTableMegabytes >= 0 &&
+                  args.learnerConfig.maxTableMegabytes <=
+                      LearnerConfig::maxTableMegabytesLimit))
+                throw ArgsError{"invalid maximum table size"};
+        }
+        else if (arg == "--eviction")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing eviction policy"};
+            std::string eviction{argv[i]};
+            if (eviction == "lru")
+                args.learnerConfig.eviction =
+                    EvictionPolicy::LeastRecentlyUsed;
+            else if (eviction == "visits")
+                args.learnerConfig.eviction = EvictionPolicy::LeastVisited;
+            else
+                throw ArgsError{"invalid eviction policy"};
+        }
+        else if (arg == "--spill")
+        {
+            args.learnerConfig.spill = true;
+        }
+        else if (arg == "--visit_sketch")
+        {
+            i += 2;
+            if (i >= argc)
+                throw ArgsError{"missing sketch dimensions"};
+            try
+            {
+                args.learnerConfig.sketchWidth = std::stoi(argv[i - 1]);
+                args.learnerConfig.sketchDepth = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing sketch dimensions"};
+            }
+            if (args.learnerConfig.sketchWidth <= 0 ||
+                args.learnerConfig.sketchDepth <= 0)
+                throw ArgsError{"invalid sketch dimensions"};
+        }
+        else if (arg == "--validate_sketch")
+        {
+            args.learnerConfig.validateSketch = true;
+        }
+        else if (arg == "--prefetch_successors")
+        {
+            args.learnerConfig.prefetchSuccessors = true;
+        }
+        else if (arg == "--shared_block_solver")
+        {
+            args.sharedBlockSolver = true;
+        }
+        else if (arg == "--eval")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing evaluation epsilon"};
+            try
+            {
+                args.learnerConfig.evalEpsilon = std::stof(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"invalid evaluation epsilon"};
+            }
+            args.learnerConfig.frozen = true;
+        }
+        else if (arg == "--action_repeat")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing action repeat"};
+            try
+            {
+                args.actionRepeat = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing action repeat"};
+            }
+            if (args.actionRepeat < 1)
+                throw ArgsError{"invalid action repeat"};
+        }
+        else if (arg == "--lookahead")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing lookahead hops"};
+            try
+            {
+                args.lookaheadHops = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing lookahead hops"};
+            }
+            if (args.lookaheadHops < 0)
+                throw ArgsError{"invalid lookahead hops"};
+        }
+        else if (arg == "--lookahead_threads")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing number of lookahead threads"};
+            try
+            {
+                args.lookaheadThreads = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing number of lookahead threads"};
+            }
+            if (args.lookaheadThreads < 1)
+                throw ArgsError{"invalid number of lookahead threads"};
+        }
+        else if (arg == "--lookahead_budget")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing lookahead budget"};
+            try
+            {
+                args.lookaheadBudget = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing lookahead budget"};
+            }
+            if (args.lookaheadBudget < 1)
+                throw ArgsError{"invalid lookahead budget"};
+        }
+        else if (arg == "--seeds")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing number of seeds"};
+            try
+            {
+                args.seeds = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing number of seeds"};
+            }
+            if (args.seeds < 1)
+                throw ArgsError{"invalid number of seeds"};
+        }
+        else if (arg == "--versus_learner")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing versus learner"};
+            args.versusLearner = argv[i];
+        }
+        else if (arg == "--versus_policy")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing versus exploration policy"};
+            args.versusPolicy = parseExplorationPolicy(argv[i], i, argc, argv);
+        }
+        else if (arg == "--significance")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing significance"};
+            try
+            {
+                args.significance = std::stod(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing significance"};
+            }
+            if (args.significance <= 0 || args.significance >= 1)
+                throw ArgsError{"invalid significance"};
+        }
+        else if (arg == "--sweep_dir")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing sweep directory"};
+            args.sweepDirectory = argv[i];
+        }
+        else if (arg == "--sweep_learners")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing sweep learners"};
+            args.sweepLearners = splitList(argv[i]);
+        }
+        else if (arg == "--sweep_policies")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing sweep exploration policies"};
+            args.sweepPolicies = splitList(argv[i]);
+            for (const auto& spec : args.sweepPolicies)
+                parseExplorationPolicySpec(spec);
+        }
+        else if (arg == "--sweep_alphas")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing sweep alphas"};
+            args.sweepAlphas = parseNumbers(argv[i], "invalid sweep alphas");
+            for (float alpha : args.sweepAlphas)
+                if (alpha <= 0 || alpha > 1)
+                    throw ArgsError{"invalid sweep alphas"};
+        }
+        else if (arg == "--sweep_gammas")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing sweep gammas"};
+            args.sweepGammas = parseNumbers(argv[i], "invalid sweep gammas");
+            for (float gamma : args.sweepGammas)
+                if (gamma < 0 || gamma > 1)
+                    throw ArgsError{"invalid sweep gammas"};
+        }
+        else if (arg == "--sweep_samples")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing number of sweep samples"};
+            try
+            {
+                args.sweepSamples = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing number of sweep samples"};
+            }
+            if (args.sweepSamples < 0)
+                throw ArgsError{"invalid number of sweep samples"};
+        }
+        else if (arg == "--population")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing population size"};
+            try
+            {
+                args.population = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing population size"};
+            }
+            if (args.population < 2)
+                throw ArgsError{"invalid population size"};
+        }
+        else if (arg == "--generations")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing number of generations"};
+            try
+            {
+                args.generations = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing number of generations"};
+            }
+            if (args.generations < 1)
+                throw ArgsError{"invalid number of generations"};
+        }
+        else if (arg == "--threads")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing number of threads"};
+            try
+            {
+                args.threads = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing number of threads"};
+            }
+            if (args.threads < 1)
+                throw ArgsError{"invalid number of threads"};
+        }
+        else if (arg == "--envs")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing number of games"};
+            try
+            {
+                args.envs = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing number of games"};
+            }
+            if (args.envs < 1)
+                throw ArgsError{"invalid number of games"};
+        }
+        else if (arg == "--table_sync")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing table synchronization"};
+            std::string sync{argv[i]};
+            if (sync == "atomic")
+                args.learnerConfig.tableSync = TableSync::Atomic;
+            else if (sync == "striped")
+                args.learnerConfig.tableSync = TableSync::Striped;
+            else
+                throw ArgsError{"invalid table synchronization"};
+        }
+        else if (arg == "--actor_learner")
+        {
+            args.actorLearner = true;
+        }
+        else if (arg == "--snapshot_interval")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing snapshot interval"};
+            try
+            {
+                args.snapshotInterval = std::stol(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing snapshot interval"};
+            }
+        }
+        else if (arg == "--workers")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing number of workers"};
+            try
+            {
+                args.workers = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing number of workers"};
+            }
+            if (args.workers < 1)
+                throw ArgsError{"invalid number of workers"};
+        }
+        else if (arg == "--table_dir")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing table directory"};
+            args.tableDirectory = argv[i];
+        }
+        else if (arg == "--checkpoint_seconds")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing checkpoint interval"};
+            try
+            {
+                args.checkpointSeconds = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing checkpoint interval"};
+            }
+        }
+        else if (arg == "--resume")
+        {
+            args.resume = true;
+        }
+        else if (arg == "--checkpoint_interval")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing checkpoint interval"};
+            try
+            {
+                args.checkpointInterval = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing checkpoint interval"};
+            }
+        }
+        else if (arg == "--snapshot_dir")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing snapshot directory"};
+            args.snapshotDirectory = argv[i];
+        }
+        else if (arg == "--curriculum")
+        {
+            args.curriculum = true;
+        }
+        else if (arg == "--explore_archive")
+        {
+            args.exploreArchive = true;
+        }
+        else if (arg == "--episodes")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing number of episodes"};
+            try
+            {
+                args.episodes = std::stoi(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing number of episodes"};
+            }
+            if (args.episodes < 0)
+                throw ArgsError{"invalid number of episodes"};
+        }
+        else if (arg == "--frames")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing number of frames"};
+            try
+            {
+                args.frames = std::stol(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing number of frames"};
+            }
+            if (args.frames < 0)
+                throw ArgsError{"invalid number of frames"};
+        }
+        else if (arg == "--time_limit")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing time limit"};
+            try
+            {
+                args.timeLimit = std::stod(argv[i]);
+            }
+            catch (...)
+            {
+                throw ArgsError{"missing time limit"};
+            }
+            if (args.timeLimit < 0)
+                throw ArgsError{"invalid time limit"};
+        }
+        else if (arg == "-i" || arg == "--input")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing input file"};
+            args.inputs.push_back(argv[i]);
+        }
+        else if (arg == "-o" || arg == "--output")
+        {
+            ++i;
+            if (i == argc)
+                throw ArgsError{"missing output file"};
+            args.output = argv[i];
         }
         else if (arg == "-h" || arg == "--help")
         {
@@ -64,11 +653,187 @@ Args parseArgs(int argc, char** argv)
         }
         else
         {
-            throw ArgsError{"invalid argument"};
+            throw ArgsError{"invalid argument"};
+        }
+    }
+
+    validateArgs(args);
+    return args;
+}
+
+void validateArgs(Args& args)
+{
+    // The evaluation epsilon is a probability.
+    if (args.learnerConfig.evalEpsilon < 0 ||
+        args.learnerConfig.evalEpsilon > 1)
+        throw ArgsError{"invalid evaluation epsilon"};
+
+    // The actors only see the masters' utilities and exact visit counts, and
+    // the tables shared between threads have a fixed layout, so they don't
+    // support the features that change how states are stored.
+    if (args.actorLearner)
+    {
+        if (args.learnerConfig.sketchWidth > 0)
+            throw ArgsError{"--visit_sketch is not supported with "
+                            "--actor_learner"};
+        if (args.resume || args.checkpointInterval > 0)
+            throw ArgsError{"checkpoints are not supported with "
+                            "--actor_learner"};
+    }
+    else if (
+        args.threads > 1 || args.envs > 1 || args.mode == "scaling" ||
+        args.mode == "coordinator" || args.mode == "evaluate" ||
+        args.mode == "compare" || !args.tableDirectory.empty())
+    {
+        const auto& config = args.learnerConfig;
+        if (config.spill || config.sketchWidth > 0 ||
+            config.maxTableMegabytes > 0)
+            throw ArgsError{"--spill, --visit_sketch and --max_table_mb are "
+                            "not supported with --threads"};
+        if (args.resume || args.checkpointInterval > 0)
+            throw ArgsError{"checkpoints are not supported with --threads"};
+    }
+
+    // The tables shared between processes are always updated with atomics.
+    if (args.mode == "coordinator")
+    {
+        if (args.workers == 0)
+            throw ArgsError{"missing number of workers"};
+        if (args.tableDirectory.empty())
+            args.tableDirectory = "/dev/shm";
+    }
+    if ((args.mode == "coordinator" || !args.tableDirectory.empty()) &&
+        args.learnerConfig.tableSync == TableSync::Striped)
+        throw ArgsError{"--table_sync striped is not supported with shared "
+                        "table files"};
+    if (args.actorLearner && !args.tableDirectory.empty())
+        throw ArgsError{"--actor_learner is not supported with --table_dir"};
+
+    if (args.lookaheadHops > 0 && args.learner == "monolithic")
+        throw ArgsError{"--lookahead needs a subsumption learner"};
+
+    // The snapshots and the archive are captured and restored by the loop of
+    // a single game.
+    if (args.curriculum && args.snapshotDirectory.empty())
+        args.snapshotDirectory = "snapshots";
+    if (!args.snapshotDirectory.empty() &&
+        (args.mode != "learn" || args.threads > 1 || args.envs > 1 ||
+         args.actorLearner || !args.tableDirectory.empty()))
+        throw ArgsError{"--snapshot_dir and --curriculum only work in learn "
+                        "mode with a single game"};
+    if (args.exploreArchive &&
+        (args.mode != "learn" || args.threads > 1 || args.envs > 1 ||
+         args.actorLearner || !args.tableDirectory.empty()))
+        throw ArgsError{"--explore_archive only works in learn mode with a "
+                        "single game"};
+    if (args.exploreArchive && args.curriculum)
+        throw ArgsError{
+            "--explore_archive and --curriculum cannot be combined"};
+
+    // The jobs of a fork server play a single game each with private copies
+    // of the tables, so they can't train them. The threads of a lookahead
+    // search are not copied into the jobs, so the search is not supported.
+    if (args.mode == "fork_server")
+    {
+        if (!args.learnerConfig.frozen)
+            throw ArgsError{"fork_server mode requires --eval"};
+        if (args.episodes == 0 && args.frames == 0 && args.timeLimit == 0)
+            throw ArgsError{"fork_server mode requires --episodes, --frames "
+                            "or --time_limit"};
+        if (args.threads > 1 || args.envs > 1 || args.actorLearner ||
+            !args.tableDirectory.empty())
+            throw ArgsError{"fork_server mode runs a single game per job"};
+        if (args.resume || args.checkpointInterval > 0)
+            throw ArgsError{"checkpoints are not supported in fork_server "
+                            "mode"};
+        if (args.lookaheadHops > 0)
+            throw ArgsError{"--lookahead is not supported in fork_server "
+                            "mode"};
+    }
+
+    // The workers of an evaluation or a comparison play whole episodes, so
+    // the limits of a run don't apply to them.
+    if (args.mode == "evaluate" || args.mode == "compare")
+    {
+        if (!args.learnerConfig.frozen)
+            throw ArgsError{args.mode + " mode requires --eval"};
+        if (args.episodes == 0)
+            throw ArgsError{args.mode + " mode requires --episodes"};
+        if (args.frames > 0 || args.timeLimit > 0)
+            throw ArgsError{"--frames and --time_limit are not supported in " +
+                            args.mode + " mode"};
+        if (args.threads > 1 || args.envs > 1 || args.actorLearner ||
+            !args.tableDirectory.empty())
+            throw ArgsError{args.mode + " mode runs a single game per worker"};
+    }
+
+    // The agents of a comparison are told apart by their tables.
+    if (args.mode == "compare")
+    {
+        if (args.versusLearner.empty())
+            args.versusLearner = args.learner;
+        if (args.versusPolicy.first.empty())
+            args.versusPolicy = args.explorationPolicy;
+        if (args.versusLearner == args.learner &&
+            args.versusPolicy.first == args.explorationPolicy.first)
+            throw ArgsError{"compare mode requires --versus_learner or "
+                            "--versus_policy"};
+        if (args.lookaheadHops > 0 && args.versusLearner == "monolithic")
+            throw ArgsError{"--lookahead needs a subsumption learner"};
+    }
+
+    // Each trial of a sweep, or member of a population, trains a single game
+    // in a process of its own, and is resumed from its checkpoint at each
+    // round.
+    if (args.mode == "sweep" || args.mode == "pbt")
+    {
+        if (args.frames == 0)
+            throw ArgsError{args.mode + " mode requires --frames"};
+        if (args.learnerConfig.frozen)
+            throw ArgsError{args.mode + " mode trains the learners, so it "
+                            "doesn't support --eval"};
+        if (args.episodes > 0 || args.timeLimit > 0)
+            throw ArgsError{"--episodes and --time_limit are not supported "
+                            "in " + args.mode + " mode"};
+        if (args.threads > 1 || args.envs > 1 || args.actorLearner ||
+            !args.tableDirectory.empty())
+            throw ArgsError{args.mode + " mode runs a single game per trial"};
+    }
+
+    // The members of a population copy each other's tables, so they must all
+    // use the same ones.
+    if (args.mode == "pbt")
+    {
+        if (!args.sweepLearners.empty() || args.sweepSamples > 0)
+            throw ArgsError{"--sweep_learners and --sweep_samples are not "
+                            "supported in pbt mode"};
+        for (const auto& spec : args.sweepPolicies)
+        {
+            if (parseExplorationPolicySpec(spec).first !=
+                parseExplorationPolicySpec(args.sweepPolicies[0]).first)
+                throw ArgsError{"pbt mode requires a single exploration "
+                                "policy"};
         }
     }
+}
 
-    return args;
+std::pair<std::string, ExplorationPolicy>
+    parseExplorationPolicySpec(const std::string& spec)
+{
+    // The parameter is passed as the next argument after the name.
+    std::vector<std::string> parts{spec};
+    auto colon = spec.find(':');
+    if (colon != std::string::npos)
+        parts = {spec.substr(0, colon), spec.substr(colon + 1)};
+    std::vector<char*> argv;
+    for (auto& part : parts)
+        argv.push_back(&part[0]);
+    int argIndex = 0;
+    auto policy = parseExplorationPolicy(
+        parts[0], argIndex, static_cast<int>(argv.size()), argv.data());
+    if (argIndex + 1 != static_cast<int>(argv.size()))
+        throw ArgsError{"invalid exploration policy " + spec};
+    return policy;
 }
 
 std::pair<std::string, ExplorationPolicy> parseExplorationPolicy(
@@ -120,6 +885,132 @@ void printUsage(const char* progname)
     std::cerr << "Usage: " << progname << " [options]" << std::endl;
     std::cerr << std::endl;
     std::cerr << "Options:" << std::endl;
+    std::cerr << "    -m <mode>" << std::endl;
+    std::cerr << "    --mode <mode>" << std::endl;
+    std::cerr << "        Sets what the program does." << std::endl;
+    std::cerr << "        The possible options are:" << std::endl;
+    std::cerr << "            learn - Trains the learner on the game."
+              << std::endl;
+    std::cerr
+        << "            compact - Removes the all-zero rows from every table"
+        << std::endl;
+    std::cerr << "                in the params/ directory and reports the"
+              << std::endl;
+    std::cerr << "                memory and file size saved." << std::endl;
+    std::cerr << "            benchmark - Times the learner's hot paths."
+              << std::endl;
+    std::cerr << "            export - Exports every table in the params/"
+              << std::endl;
+    std::cerr << "                directory to an immutable .policy file for"
+              << std::endl;
+    std::cerr << "                inference, and compares its size and lookup"
+              << std::endl;
+    std::cerr << "                time with the live table. The frozen learners"
+              << std::endl;
+    std::cerr << "                of --eval read a .policy file instead of"
+              << std::endl;
+    std::cerr << "                the param file while it is up to date."
+              << std::endl;
+    std::cerr << "            scaling - Trains the learner with 1, 2, 4, and"
+              << std::endl;
+    std::cerr << "                so on up to one thread per core, for 30"
+              << std::endl;
+    std::cerr << "                seconds each, and reports the frames per"
+              << std::endl;
+    std::cerr << "                second." << std::endl;
+    std::cerr << "            coordinator - Trains the learner in several"
+              << std::endl;
+    std::cerr << "                worker processes that share its tables"
+              << std::endl;
+    std::cerr << "                through files in a directory. The coordinator"
+              << std::endl;
+    std::cerr << "                creates the tables, restarts the workers that"
+              << std::endl;
+    std::cerr << "                crash, saves the tables periodically, and"
+              << std::endl;
+    std::cerr << "                removes their files when it is stopped."
+              << std::endl;
+    std::cerr << "            fork_server - Loads the ROM and the tables once"
+              << std::endl;
+    std::cerr << "                and reads evaluation jobs from the standard"
+              << std::endl;
+    std::cerr << "                input, one <seed> <results_file> line each."
+              << std::endl;
+    std::cerr << "                Each job runs in a forked process that starts"
+              << std::endl;
+    std::cerr << "                playing right away, and reports how long it"
+              << std::endl;
+    std::cerr << "                took to start. Requires --eval and a limit."
+              << std::endl;
+    std::cerr << "            evaluate - Plays --episodes episodes from each of"
+              << std::endl;
+    std::cerr << "                --seeds seeds with the frozen learner on"
+              << std::endl;
+    std::cerr << "                --workers threads, and prints the mean,"
+              << std::endl;
+    std::cerr << "                standard deviation and quantiles of the"
+              << std::endl;
+    std::cerr << "                scores and the highest level reached."
+              << std::endl;
+    std::cerr << "                Requires --eval." << std::endl;
+    std::cerr << "            compare - Plays pairs of episodes from the same"
+              << std::endl;
+    std::cerr << "                seeds with the frozen learner and the one"
+              << std::endl;
+    std::cerr << "                given by --versus_learner and"
+              << std::endl;
+    std::cerr << "                --versus_policy on --workers threads, until"
+              << std::endl;
+    std::cerr << "                a sequential test finds that one scores"
+              << std::endl;
+    std::cerr << "                higher or --episodes pairs are played. Then"
+              << std::endl;
+    std::cerr << "                reports the frames saved compared to playing"
+              << std::endl;
+    std::cerr << "                every pair. Requires --eval." << std::endl;
+    std::cerr << "            sweep - Trains a trial of each combination of"
+              << std::endl;
+    std::cerr << "                the --sweep_* settings and --seeds seeds,"
+              << std::endl;
+    std::cerr << "                each in a process of its own with its own"
+              << std::endl;
+    std::cerr << "                directory in --sweep_dir, on --workers"
+              << std::endl;
+    std::cerr << "                processes. The trials train for --frames"
+              << std::endl;
+    std::cerr << "                frames, then the best third of them for"
+              << std::endl;
+    std::cerr << "                three times as many, and so on until one"
+              << std::endl;
+    std::cerr << "                is left. Writes a ranked leaderboard.csv to"
+              << std::endl;
+    std::cerr << "                the sweep directory." << std::endl;
+    std::cerr << "            pbt - Trains a population of --population"
+              << std::endl;
+    std::cerr << "                learners with settings drawn from the"
+              << std::endl;
+    std::cerr << "                --sweep_* values, each in a process of its"
+              << std::endl;
+    std::cerr << "                own with its own directory in --sweep_dir,"
+              << std::endl;
+    std::cerr << "                for --generations rounds of --frames frames."
+              << std::endl;
+    std::cerr << "                After each round, the worst quarter copy the"
+              << std::endl;
+    std::cerr << "                tables and settings of the best quarter and"
+              << std::endl;
+    std::cerr << "                perturb the settings. Writes a ranked"
+              << std::endl;
+    std::cerr << "                leaderboard.csv to the sweep directory."
+              << std::endl;
+    std::cerr << "            merge - Merges the input param files into the"
+              << std::endl;
+    std::cerr << "                output param file. The inputs must come from"
+              << std::endl;
+    std::cerr << "                learners with the same state encoding."
+              << std::endl;
+    std::cerr << "        Defaults to " << args.mode << "." << std::endl;
+    std::cerr << std::endl;
     std::cerr << "    -r <rom_file>" << std::endl;
     std::cerr << "    --rom <rom_file>" << std::endl;
     std::cerr << "        Sets the ROM file for the game." << std::endl;
@@ -127,7 +1018,9 @@ void printUsage(const char* progname)
     std::cerr << std::endl;
     std::cerr << "    -s <random_seed>" << std::endl;
     std::cerr << "    --seed <random_seed>" << std::endl;
-    std::cerr << "        Sets the random seed used by the ALE." << std::endl;
+    std::cerr
+        << "        Sets the random seed used by the ALE and the learners."
+        << std::endl;
     std::cerr << "        Defaults to " << args.randomSeed << "." << std::endl;
     std::cerr << std::endl;
     std::cerr << "    -x" << std::endl;
@@ -163,6 +1056,19 @@ void printUsage(const char* progname)
         << std::endl;
     std::cerr << "        Defaults to " << args.learner << "." << std::endl;
     std::cerr << std::endl;
+    std::cerr << "    --shared_block_solver" << std::endl;
+    std::cerr << "        Makes the subsumption learners start from the"
+              << std::endl;
+    std::cerr << "        combined experience of their block solvers. If it"
+              << std::endl;
+    std::cerr << "        does not exist yet, the learner's shared block"
+              << std::endl;
+    std::cerr << "        solver table is created by merging the block solver"
+              << std::endl;
+    std::cerr << "        tables of all the subsumption learners. With --eval,"
+              << std::endl;
+    std::cerr << "        the table must already exist." << std::endl;
+    std::cerr << std::endl;
     std::cerr << "    -e <exploration_policy>" << std::endl;
     std::cerr << "    --exploration_policy <exploration_policy>" << std::endl;
     std::cerr << "        Sets the exploration policy used by the learner."
@@ -187,6 +1093,412 @@ void printUsage(const char* progname)
     std::cerr << "        Defaults to " << args.explorationPolicy.first << "."
               << std::endl;
     std::cerr << std::endl;
+    std::cerr << "    --alpha <alpha>" << std::endl;
+    std::cerr << "        Sets the learning rate of the learner."
+              << std::endl;
+    std::cerr << "        Defaults to " << args.learnerConfig.alpha << "."
+              << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --gamma <gamma>" << std::endl;
+    std::cerr << "        Sets the discount factor of the learner."
+              << std::endl;
+    std::cerr << "        Defaults to " << args.learnerConfig.gamma << "."
+              << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --eval <epsilon>" << std::endl;
+    std::cerr << "        Evaluates the learner without training it. The"
+              << std::endl;
+    std::cerr << "        parameters are loaded read-only and never saved, and"
+              << std::endl;
+    std::cerr << "        a random action is taken with probability epsilon."
+              << std::endl;
+    std::cerr << "        Use 0 for a greedy policy. The results are stored in"
+              << std::endl;
+    std::cerr << "        results/eval.<learner>.<exploration_policy>.csv."
+              << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --cache_size <slots>" << std::endl;
+    std::cerr
+        << "        Sets the number of slots in the direct-mapped cache for hot"
+        << std::endl;
+    std::cerr << "        states in front of each learner's table. Use 0 to"
+              << std::endl;
+    std::cerr << "        disable the cache. At most "
+              << LearnerConfig::maxCacheSize << "." << std::endl;
+    std::cerr << "        Defaults to " << args.learnerConfig.cacheSize << "."
+              << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --max_states <states>" << std::endl;
+    std::cerr << "        Sets the maximum number of states kept in memory by"
+              << std::endl;
+    std::cerr << "        each learner. Use 0 for no limit. At most "
+              << LearnerConfig::maxStatesLimit << "." << std::endl;
+    std::cerr << "        Defaults to " << args.learnerConfig.maxStates << "."
+              << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --max_table_mb <megabytes>" << std::endl;
+    std::cerr << "        Sets the maximum memory used by the table of each"
+              << std::endl;
+    std::cerr << "        learner. Use 0 for no limit. At most "
+              << LearnerConfig::maxTableMegabytesLimit << "." << std::endl;
+    std::cerr << "        Defaults to " << args.learnerConfig.maxTableMegabytes
+              << "." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --eviction <eviction_policy>" << std::endl;
+    std::cerr << "        Sets which states are evicted first when a learner"
+              << std::endl;
+    std::cerr << "        is over its memory budget." << std::endl;
+    std::cerr << "        The possible options are:" << std::endl;
+    std::cerr << "            lru - Evicts the least recently used states."
+              << std::endl;
+    std::cerr << "            visits - Evicts the least visited states."
+              << std::endl;
+    std::cerr << "        Defaults to lru." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --spill" << std::endl;
+    std::cerr << "        Keeps evicted states in a spill file so that they"
+              << std::endl;
+    std::cerr << "        are still saved with the parameters. States that"
+              << std::endl;
+    std::cerr << "        come back after being evicted are read back from the"
+              << std::endl;
+    std::cerr << "        spill file." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --visit_sketch <width> <depth>" << std::endl;
+    std::cerr << "        Keeps the visit counts used for exploration in a"
+              << std::endl;
+    std::cerr << "        count-min sketch of depth rows of width counters,"
+              << std::endl;
+    std::cerr << "        instead of exact counts in the table. The sketch is"
+              << std::endl;
+    std::cerr << "        saved next to the parameters, and the exact visit"
+              << std::endl;
+    std::cerr << "        counts are no longer saved, so a table that already"
+              << std::endl;
+    std::cerr << "        has them also needs --validate_sketch." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --validate_sketch" << std::endl;
+    std::cerr << "        Keeps exact visit counts alongside the sketch and"
+              << std::endl;
+    std::cerr << "        reports how often the sketch changes the exploration"
+              << std::endl;
+    std::cerr << "        decision." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --prefetch_successors" << std::endl;
+    std::cerr << "        Prefetches the table rows of the states that each"
+              << std::endl;
+    std::cerr << "        move could lead to while the emulator plays the move,"
+              << std::endl;
+    std::cerr << "        and reports how long the lookups take with and"
+              << std::endl;
+    std::cerr << "        without a prefetch, as well as the stall time saved"
+              << std::endl;
+    std::cerr << "        per decision." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --action_repeat <frames>" << std::endl;
+    std::cerr << "        Repeats each action for up to the given number of"
+              << std::endl;
+    std::cerr << "        frames without looking at the screen, stopping early"
+              << std::endl;
+    std::cerr << "        once the game accepts a new action. The rewards and"
+              << std::endl;
+    std::cerr << "        deaths of the repeated frames still count."
+              << std::endl;
+    std::cerr << "        Defaults to " << args.actionRepeat << "."
+              << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --lookahead <hops>" << std::endl;
+    std::cerr << "        Checks the enemy avoider's actions by rolling out"
+              << std::endl;
+    std::cerr << "        each valid move for the given number of hops from a"
+              << std::endl;
+    std::cerr << "        copy of the game, and takes the move with the best"
+              << std::endl;
+    std::cerr << "        sum of its utility and its mean return, counting a"
+              << std::endl;
+    std::cerr << "        death as -1000. Only works with the subsumption"
+              << std::endl;
+    std::cerr << "        learners, and not in fork_server mode."
+              << std::endl;
+    std::cerr << "        Defaults to " << args.lookaheadHops
+              << ", which turns the search off." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --lookahead_threads <threads>" << std::endl;
+    std::cerr << "        Runs the rollouts of the lookahead search on the"
+              << std::endl;
+    std::cerr << "        given number of threads, each with its own emulator."
+              << std::endl;
+    std::cerr << "        Defaults to " << args.lookaheadThreads << "."
+              << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --lookahead_budget <microseconds>" << std::endl;
+    std::cerr << "        Stops each lookahead search after the given time,"
+              << std::endl;
+    std::cerr << "        keeping the enemy avoider's action if a move has no"
+              << std::endl;
+    std::cerr << "        finished rollouts. Defaults to "
+              << args.lookaheadBudget << "." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --threads <threads>" << std::endl;
+    std::cerr << "        Trains with the given number of threads, each playing"
+              << std::endl;
+    std::cerr << "        its own game with its own random seed, starting at"
+              << std::endl;
+    std::cerr << "        the given seed. All the threads share the learners'"
+              << std::endl;
+    std::cerr << "        tables, which then hold up to --max_states states."
+              << std::endl;
+    std::cerr << "        Defaults to " << args.threads << "." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --envs <games>" << std::endl;
+    std::cerr << "        Sets the number of games that each thread plays in"
+              << std::endl;
+    std::cerr << "        lockstep. The games share the learners' tables as"
+              << std::endl;
+    std::cerr << "        with --threads, and the table rows of all their"
+              << std::endl;
+    std::cerr << "        decisions are prefetched at once." << std::endl;
+    std::cerr << "        Defaults to " << args.envs << "." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --table_sync <synchronization>" << std::endl;
+    std::cerr << "        Sets how the threads synchronize their updates to the"
+              << std::endl;
+    std::cerr << "        shared tables." << std::endl;
+    std::cerr << "        The possible options are:" << std::endl;
+    std::cerr << "            atomic - Lock-free atomic updates, with rows read"
+              << std::endl;
+    std::cerr << "                without synchronization, as in Hogwild."
+              << std::endl;
+    std::cerr << "            striped - Rows are read and updated under one of"
+              << std::endl;
+    std::cerr << "                a fixed set of locks." << std::endl;
+    std::cerr << "        Defaults to atomic." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --actor_learner" << std::endl;
+    std::cerr << "        Makes the threads actors that only play the game and"
+              << std::endl;
+    std::cerr << "        act from snapshots of the tables. Their transitions"
+              << std::endl;
+    std::cerr << "        go through lock-free queues to a separate learner"
+              << std::endl;
+    std::cerr << "        thread, which is the only one to update the tables."
+              << std::endl;
+    std::cerr << "        The queue depth and the staleness of the snapshots"
+              << std::endl;
+    std::cerr << "        are reported with the results." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --snapshot_interval <transitions>" << std::endl;
+    std::cerr << "        Sets the number of transitions the learner thread"
+              << std::endl;
+    std::cerr << "        applies to a table before it publishes a new snapshot"
+              << std::endl;
+    std::cerr << "        of it for the actors." << std::endl;
+    std::cerr << "        Defaults to " << args.snapshotInterval << "."
+              << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --workers <workers>" << std::endl;
+    std::cerr << "        Sets the number of worker processes in coordinator"
+              << std::endl;
+    std::cerr << "        mode. Each worker gets its own random seed, starting"
+              << std::endl;
+    std::cerr << "        at the given seed, and runs --threads threads."
+              << std::endl;
+    std::cerr << "        In fork_server, sweep and pbt modes, sets the number"
+              << std::endl;
+    std::cerr << "        of jobs or trials that run at once instead, and in"
+              << std::endl;
+    std::cerr << "        evaluate and compare modes, the number of threads,"
+              << std::endl;
+    std::cerr << "        with 0 for one per core." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --seeds <seeds>" << std::endl;
+    std::cerr << "        Sets the number of seeds played in evaluate mode, or"
+              << std::endl;
+    std::cerr << "        tried for each combination in sweep mode,"
+              << std::endl;
+    std::cerr << "        starting at the given seed." << std::endl;
+    std::cerr << "        Defaults to " << args.seeds << "." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --versus_learner <learner>" << std::endl;
+    std::cerr << "    --versus_policy <policy>" << std::endl;
+    std::cerr << "        Sets the learner and the exploration policy that"
+              << std::endl;
+    std::cerr << "        the given ones are compared with in compare mode."
+              << std::endl;
+    std::cerr << "        Each defaults to the given one, but one of them must"
+              << std::endl;
+    std::cerr << "        differ." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --sweep_dir <directory>" << std::endl;
+    std::cerr << "        Sets the directory of the trials of a sweep, which"
+              << std::endl;
+    std::cerr << "        must not hold the trials of another sweep."
+              << std::endl;
+    std::cerr << "        Defaults to " << args.sweepDirectory << "."
+              << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --sweep_learners <learner>,..." << std::endl;
+    std::cerr << "    --sweep_policies <policy>[:<parameter>],..."
+              << std::endl;
+    std::cerr << "    --sweep_alphas <alpha>,..." << std::endl;
+    std::cerr << "    --sweep_gammas <gamma>,..." << std::endl;
+    std::cerr << "        Sets the values that a sweep tries for each setting,"
+              << std::endl;
+    std::cerr << "        such as threshold:10,epsilon_greedy:0.1 for the"
+              << std::endl;
+    std::cerr << "        exploration policies. Each defaults to the single"
+              << std::endl;
+    std::cerr << "        value given by its own option." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --sweep_samples <trials>" << std::endl;
+    std::cerr << "        Samples the given number of random trials instead of"
+              << std::endl;
+    std::cerr << "        trying every combination. The learning rate and the"
+              << std::endl;
+    std::cerr << "        discount factor are then drawn uniformly between the"
+              << std::endl;
+    std::cerr << "        smallest and largest values in their lists."
+              << std::endl;
+    std::cerr << "        Defaults to " << args.sweepSamples
+              << ", which tries every combination." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --population <members>" << std::endl;
+    std::cerr << "        Sets the number of learners trained by pbt mode."
+              << std::endl;
+    std::cerr << "        Defaults to " << args.population << "." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --generations <rounds>" << std::endl;
+    std::cerr << "        Sets the number of rounds of --frames frames that"
+              << std::endl;
+    std::cerr << "        pbt mode trains the population for." << std::endl;
+    std::cerr << "        Defaults to " << args.generations << "." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --significance <alpha>" << std::endl;
+    std::cerr << "        Sets the false positive rate of the sequential test"
+              << std::endl;
+    std::cerr << "        in compare mode, which holds however early the test"
+              << std::endl;
+    std::cerr << "        stops. Defaults to " << args.significance << "."
+              << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --table_dir <directory>" << std::endl;
+    std::cerr << "        Sets the directory of the table files shared between"
+              << std::endl;
+    std::cerr << "        processes. In learn mode, the learner uses the tables"
+              << std::endl;
+    std::cerr << "        of a running coordinator instead of its own, and its"
+              << std::endl;
+    std::cerr << "        results get the seed in their file name."
+              << std::endl;
+    std::cerr << "        Defaults to /dev/shm in coordinator mode."
+              << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --checkpoint_seconds <seconds>" << std::endl;
+    std::cerr << "        Sets how often the coordinator saves the shared"
+              << std::endl;
+    std::cerr << "        tables to the param files." << std::endl;
+    std::cerr << "        Defaults to " << args.checkpointSeconds << "."
+              << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --resume" << std::endl;
+    std::cerr
+        << "        Resumes the run from its last checkpoint. A checkpoint"
+        << std::endl;
+    std::cerr << "        is written after every episode next to the results"
+              << std::endl;
+    std::cerr << "        file, and holds the episode number, the random state"
+              << std::endl;
+    std::cerr << "        and the size of the results file." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --checkpoint_interval <frames>" << std::endl;
+    std::cerr << "        Also writes a checkpoint every given number of frames"
+              << std::endl;
+    std::cerr << "        in the middle of an episode. These checkpoints save"
+              << std::endl;
+    std::cerr << "        the tables and the emulator state, so that a resumed"
+              << std::endl;
+    std::cerr << "        run continues the game in progress. Use 0 to only"
+              << std::endl;
+    std::cerr << "        write checkpoints between episodes." << std::endl;
+    std::cerr << "        Defaults to " << args.checkpointInterval << "."
+              << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --snapshot_dir <directory>" << std::endl;
+    std::cerr << "        Saves a snapshot of the game at the start of every"
+              << std::endl;
+    std::cerr << "        level to a library in the given directory, keeping"
+              << std::endl;
+    std::cerr << "        the most recent snapshots of each level."
+              << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --curriculum" << std::endl;
+    std::cerr << "        Starts every game from a snapshot in the library"
+              << std::endl;
+    std::cerr << "        instead of the first level, choosing each level with"
+              << std::endl;
+    std::cerr << "        a weight of its number plus one. The games start from"
+              << std::endl;
+    std::cerr << "        the first level until the library has snapshots. The"
+              << std::endl;
+    std::cerr << "        results are written to their own file." << std::endl;
+    std::cerr << "        The library defaults to the snapshots/ directory."
+              << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --explore_archive" << std::endl;
+    std::cerr << "        Keeps an archive of the situations reached, as a hash"
+              << std::endl;
+    std::cerr << "        of the level, the position of Qbert and the blocks"
+              << std::endl;
+    std::cerr << "        at the goal color, with the game that reached each"
+              << std::endl;
+    std::cerr << "        one. Every game ends at its first death and the next"
+              << std::endl;
+    std::cerr << "        one returns to a rarely visited situation instead of"
+              << std::endl;
+    std::cerr << "        starting over. The archive is kept in memory, and its"
+              << std::endl;
+    std::cerr << "        size and discovery rate are printed at the end. The"
+              << std::endl;
+    std::cerr << "        results are written to their own file." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --episodes <episodes>" << std::endl;
+    std::cerr << "        Stops after the given number of episodes, or never"
+              << std::endl;
+    std::cerr << "        if it is 0." << std::endl;
+    std::cerr << "        Defaults to " << args.episodes << "." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --frames <frames>" << std::endl;
+    std::cerr << "        Stops after the given number of frames, or never if"
+              << std::endl;
+    std::cerr << "        it is 0. A run stopped in the middle of an episode"
+              << std::endl;
+    std::cerr << "        saves its tables and writes a checkpoint of the game"
+              << std::endl;
+    std::cerr << "        in progress, so that --resume can continue it."
+              << std::endl;
+    std::cerr << "        Defaults to " << args.frames << "." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    --time_limit <seconds>" << std::endl;
+    std::cerr << "        Stops after the given number of seconds, or never if"
+              << std::endl;
+    std::cerr << "        it is 0, in the same way as --frames." << std::endl;
+    std::cerr << "        Defaults to " << args.timeLimit << "." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    -i <param_file>" << std::endl;
+    std::cerr << "    --input <param_file>" << std::endl;
+    std::cerr << "        Adds a param file to merge in merge mode. Can be"
+              << std::endl;
+    std::cerr << "        given more than once. The utilities are averaged"
+              << std::endl;
+    std::cerr << "        with weights given by the visit counts, and the"
+              << std::endl;
+    std::cerr << "        visit counts are summed." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "    -o <param_file>" << std::endl;
+    std::cerr << "    --output <param_file>" << std::endl;
+    std::cerr << "        Sets the param file written in merge mode."
+              << std::endl;
+    std::cerr << std::endl;
     std::cerr << "    -h" << std::endl;
     std::cerr << "    --help" << std::endl;
     std::cerr << "        Prints usage information." << std::endl;
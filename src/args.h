@@ -2,14 +2,18 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 #include <stdexcept>
 
 #include "exploration-policy.h"
+#include "learner-config.h"
 
 namespace Qbert {
 
 struct Args
 {
+    std::string mode{"learn"};
+
     std::string rom{"qbert.bin"};
     int randomSeed{123};
     bool displayScreen{false};
@@ -17,6 +21,53 @@ struct Args
     std::string learner{"subsumption-v2"};
     std::pair<std::string, ExplorationPolicy> explorationPolicy{
         "inverse_proportional", ExploreInverseProportional{}};
+    // The exploration policy above as <name>[:<parameter>].
+    std::string explorationPolicySpec{"inverse_proportional"};
+    LearnerConfig learnerConfig;
+    bool sharedBlockSolver{false};
+
+    int actionRepeat{1};
+    int lookaheadHops{0};
+    int lookaheadThreads{4};
+    int lookaheadBudget{20000};
+
+    int threads{1};
+    int envs{1};
+    bool actorLearner{false};
+    long snapshotInterval{10000};
+
+    int workers{0};
+    int seeds{1};
+
+    std::string versusLearner;
+    std::pair<std::string, ExplorationPolicy> versusPolicy;
+    double significance{0.05};
+
+    std::string sweepDirectory{"sweeps"};
+    std::vector<std::string> sweepLearners;
+    std::vector<std::string> sweepPolicies;
+    std::vector<float> sweepAlphas;
+    std::vector<float> sweepGammas;
+    int sweepSamples{0};
+    int population{8};
+    int generations{10};
+
+    std::string tableDirectory;
+    int checkpointSeconds{60};
+
+    bool resume{false};
+    int checkpointInterval{0};
+
+    std::string snapshotDirectory;
+    bool curriculum{false};
+    bool exploreArchive{false};
+
+    int episodes{0};
+    long frames{0};
+    double timeLimit{0};
+
+    std::vector<std::string> inputs;
+    std::string output;
 
     bool help{false};
     bool debug{false};
@@ -42,6 +93,15 @@ public:
 // Parses the command line arguments.
 Args parseArgs(int argc, char** argv);
 
+// Checks that the given arguments can be used together, and fills in the
+// defaults that depend on other arguments. Throws an ArgsError otherwise.
+void validateArgs(Args& args);
+
+// Parses an exploration policy written as its name, followed by its parameter
+// after a colon if it has one, such as threshold:10.
+std::pair<std::string, ExplorationPolicy>
+    parseExplorationPolicySpec(const std::string& spec);
+
 // Prints usage information to std::cerr.
 void printUsage(const char* progname);
 }
@@ -0,0 +1,133 @@
+#include "benchmark.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <algorithm>
+
+#include "action-selection.h"
+#include "q-table.h"
+
+namespace Qbert {
+
+// Times the given function over the given number of calls and returns the
+// average time per call in nanoseconds.
+template <typename F>
+static double timePerCall(int calls, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i)
+        f(i);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+        calls;
+}
+
+// Compares the SIMD action selection kernel with the scalar version on random
+// rows that are small enough to stay in the L1 cache.
+static void benchmarkActionSelection()
+{
+    constexpr int rows = 1024;
+    constexpr int calls = 10000000;
+
+    std::mt19937 generator{0};
+    std::uniform_real_distribution<float> utility{-100, 100};
+    std::uniform_int_distribution<int> visits{0, 10};
+    std::uniform_int_distribution<int> masks{1, 15};
+    std::vector<QEntry> entries(rows);
+    std::vector<int> actionMasks(rows);
+    for (int i = 0; i < rows; ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+        {
+            // A few utilities are rounded so that ties are exercised.
+            float u = utility(generator);
+            entries[i].utilities[j] = i % 4 == 0 ? static_cast<int>(u / 50) : u;
+            entries[i].visited[j] = visits(generator);
+        }
+        actionMasks[i] = masks(generator);
+    }
+
+    for (int i = 0; i < rows; ++i)
+    {
+        auto simd = selectActions(
+            entries[i].utilities.data(),
+            entries[i].visited.data(),
+            actionMasks[i]);
+        auto scalar = selectActionsScalar(
+            entries[i].utilities.data(),
+            entries[i].visited.data(),
+            actionMasks[i]);
+        if (simd.maxUtility != scalar.maxUtility ||
+            simd.minVisited != scalar.minVisited ||
+            simd.bestMask != scalar.bestMask)
+            throw std::logic_error{"action selection kernels disagree"};
+    }
+
+    volatile int sink = 0;
+    auto simdTime = timePerCall(calls, [&](int i) {
+        const auto& entry = entries[i % rows];
+        auto selection = selectActions(
+            entry.utilities.data(),
+            entry.visited.data(),
+            actionMasks[i % rows]);
+        sink = sink + selection.bestMask + selection.minVisited;
+    });
+    auto scalarTime = timePerCall(calls, [&](int i) {
+        const auto& entry = entries[i % rows];
+        auto selection = selectActionsScalar(
+            entry.utilities.data(),
+            entry.visited.data(),
+            actionMasks[i % rows]);
+        sink = sink + selection.bestMask + selection.minVisited;
+    });
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Action selection (SIMD): " << simdTime << " ns/call"
+              << std::endl;
+    std::cout << "Action selection (scalar): " << scalarTime << " ns/call"
+              << std::endl;
+}
+
+std::pair<double, double> comparePolicyLookups(
+    const ParamTable& table, const PolicyArtifact& artifact)
+{
+    constexpr int calls = 2000000;
+    if (table.empty())
+        return {0, 0};
+
+    // The live table uses the same settings as a learner with the defaults.
+    QTable live{LearnerConfig{}};
+    std::vector<int> states;
+    for (const auto& p : table)
+    {
+        live.get(p.first) = p.second;
+        states.push_back(p.first);
+    }
+    std::mt19937 generator{0};
+    std::shuffle(states.begin(), states.end(), generator);
+
+    volatile int sink = 0;
+    auto liveTime = timePerCall(calls, [&](int i) {
+        const auto& entry = live.find(states[i % states.size()]);
+        auto selection = selectActions(
+            entry.utilities.data(), entry.visited.data(), 15);
+        sink = sink + selection.bestMask;
+    });
+    alignas(16) static const QEntry::VisitRow noVisits{};
+    auto artifactTime = timePerCall(calls, [&](int i) {
+        auto utilities = artifact.find(states[i % states.size()]);
+        auto selection = selectActions(utilities, noVisits.data(), 15);
+        sink = sink + selection.bestMask;
+    });
+    return {liveTime, artifactTime};
+}
+
+void benchmark(const Args& /*args*/)
+{
+    benchmarkActionSelection();
+}
+}
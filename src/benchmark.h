@@ -0,0 +1,20 @@
+#pragma once
+
+#include <utility>
+
+#include "args.h"
+#include "param-file.h"
+#include "policy-artifact.h"
+
+namespace Qbert {
+
+// Runs the micro-benchmarks for the learner's hot paths and prints the time per
+// call to std::cout.
+void benchmark(const Args& args);
+
+// Times action selection for random visited states using a live table built
+// from the given param table and using the given artifact. Returns the average
+// time per lookup in nanoseconds for each of them.
+std::pair<double, double> comparePolicyLookups(
+    const ParamTable& table, const PolicyArtifact& artifact);
+}
@@ -0,0 +1,49 @@
+#include "checkpoint.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <cstdio>
+
+namespace Qbert {
+
+void writeString(std::ostream& os, const std::string& s)
+{
+    os << s.size() << std::endl;
+    os.write(s.data(), s.size());
+    os << std::endl;
+}
+
+void readString(std::istream& is, std::string& s)
+{
+    std::size_t size;
+    is >> size;
+    is.get();
+    s.resize(size);
+    is.read(&s[0], size);
+}
+
+bool readCheckpoint(const std::string& path, Checkpoint& checkpoint)
+{
+    std::ifstream is{path, std::ios::binary};
+    if (!is)
+        return false;
+    is >> checkpoint.episode >> checkpoint.resultsOffset;
+    readString(is, checkpoint.randomState);
+    readString(is, checkpoint.systemState);
+    readString(is, checkpoint.agentState);
+    if (!is)
+        throw std::runtime_error{"invalid checkpoint " + path};
+    return true;
+}
+
+void writeCheckpoint(const std::string& path, const Checkpoint& checkpoint)
+{
+    std::ofstream os{path + ".temp", std::ios::binary};
+    os << checkpoint.episode << " " << checkpoint.resultsOffset << std::endl;
+    writeString(os, checkpoint.randomState);
+    writeString(os, checkpoint.systemState);
+    writeString(os, checkpoint.agentState);
+    os.close();
+    rename((path + ".temp").c_str(), path.c_str());
+}
+}
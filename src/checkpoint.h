@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <iostream>
+
+namespace Qbert {
+
+// The state of a training run that is not stored in the param files.
+struct Checkpoint
+{
+    // The number of episodes completed.
+    int episode{0};
+
+    // The size of the results file in bytes. Anything written after this point
+    // belongs to episodes that are played again on resume.
+    long resultsOffset{0};
+
+    // The state of the random number engine of the learners.
+    std::string randomState;
+
+    // The emulator state of the game in progress, or an empty string if the
+    // checkpoint was taken between games.
+    std::string systemState;
+
+    // The agent state of the game in progress, as written by Agent::saveState.
+    std::string agentState;
+};
+
+// Writes a string with its size, so that it can hold binary data such as the
+// emulator state.
+void writeString(std::ostream& os, const std::string& s);
+
+// Reads a string written by writeString.
+void readString(std::istream& is, std::string& s);
+
+// Reads the checkpoint at the given path. Returns false if it does not exist.
+bool readCheckpoint(const std::string& path, Checkpoint& checkpoint);
+
+// Writes the checkpoint to the given path. The file is replaced atomically, so
+// that a run killed in the middle of writing keeps its previous checkpoint.
+void writeCheckpoint(const std::string& path, const Checkpoint& checkpoint);
+}
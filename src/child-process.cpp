@@ -0,0 +1,44 @@
+#include "child-process.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include <unistd.h>
+
+namespace Qbert {
+
+int getWorkerCount(int workers)
+{
+    return workers > 0
+        ? workers
+        : std::max<int>(std::thread::hardware_concurrency(), 1);
+}
+
+pid_t runInChild(const std::string& name, const std::function<void()>& run)
+{
+    // The output buffered so far would otherwise be written by both.
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0)
+        throw std::runtime_error{"cannot start " + name};
+    if (pid > 0)
+        return pid;
+
+    int status = 0;
+    try
+    {
+        run();
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Error in " << name << ": " << e.what() << std::endl;
+        status = 1;
+    }
+    // The child leaves with _exit, so that it doesn't run the destructors of
+    // the parent's objects that it inherited.
+    std::cout.flush();
+    _exit(status);
+}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include <sys/types.h>
+
+namespace Qbert {
+
+// Returns the given number of workers, or one per core if it is 0.
+int getWorkerCount(int workers);
+
+// Runs the given function in a new process forked from the current one, and
+// returns the id of the child. The child exits with status 0 once the function
+// returns, or reports the error as coming from the given name and exits with
+// status 1 if it throws. Only the calling thread is copied into the child.
+pid_t runInChild(const std::string& name, const std::function<void()>& run);
+}
@@ -0,0 +1,80 @@
+#include "count-min-sketch.h"
+
+#include <algorithm>
+
+namespace Qbert {
+
+// The counters saturate here, in the same way as the exact visit counts.
+static constexpr std::uint32_t maxCount = 999999999;
+
+CountMinSketch::CountMinSketch(int width, int depth)
+    : width{width},
+      depth{depth},
+      counters(static_cast<std::size_t>(width) * depth)
+{
+}
+
+void CountMinSketch::add(std::uint64_t key, std::uint32_t amount)
+{
+    // With conservative updates, only the counters that are below the new
+    // estimate are raised, which keeps the overestimation from collisions
+    // much smaller than with plain updates.
+    auto target = std::min<std::uint64_t>(
+        static_cast<std::uint64_t>(estimate(key)) + amount, maxCount);
+    for (int row = 0; row < depth; ++row)
+    {
+        auto& counter = counters[index(key, row)];
+        counter = std::max<std::uint32_t>(counter, target);
+    }
+}
+
+std::uint32_t CountMinSketch::estimate(std::uint64_t key) const
+{
+    std::uint32_t result = maxCount;
+    for (int row = 0; row < depth; ++row)
+        result = std::min(result, counters[index(key, row)]);
+    return result;
+}
+
+std::size_t CountMinSketch::getMemoryUsage() const
+{
+    return counters.size() * sizeof(std::uint32_t);
+}
+
+void CountMinSketch::save(std::ostream& os) const
+{
+    os.write(reinterpret_cast<const char*>(&width), sizeof(width));
+    os.write(reinterpret_cast<const char*>(&depth), sizeof(depth));
+    os.write(
+        reinterpret_cast<const char*>(counters.data()),
+        counters.size() * sizeof(std::uint32_t));
+}
+
+bool CountMinSketch::load(std::istream& is)
+{
+    int savedWidth = 0, savedDepth = 0;
+    is.read(reinterpret_cast<char*>(&savedWidth), sizeof(savedWidth));
+    is.read(reinterpret_cast<char*>(&savedDepth), sizeof(savedDepth));
+    if (!is || savedWidth != width || savedDepth != depth)
+        return false;
+    std::vector<std::uint32_t> saved(counters.size());
+    is.read(
+        reinterpret_cast<char*>(saved.data()),
+        saved.size() * sizeof(std::uint32_t));
+    if (!is)
+        return false;
+    counters.swap(saved);
+    return true;
+}
+
+std::size_t CountMinSketch::index(std::uint64_t key, int row) const
+{
+    // Each row uses a different multiplier of the form used by the SplitMix64
+    // finalizer, which gives well mixed and roughly independent hashes.
+    std::uint64_t hash = key + 0x9E3779B97F4A7C15ull * (row + 1);
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    hash ^= hash >> 31;
+    return static_cast<std::size_t>(row) * width + hash % width;
+}
+}
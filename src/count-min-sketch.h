@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+
+namespace Qbert {
+
+// A count-min sketch with conservative updates. It approximates a set of
+// counters in a fixed amount of memory, and its estimates never undercount.
+class CountMinSketch
+{
+    int width, depth;
+    std::vector<std::uint32_t> counters;
+
+public:
+    // Constructs a sketch with depth rows of width counters each.
+    CountMinSketch(int width, int depth);
+
+    // Adds the given amount to the counter for the given key.
+    void add(std::uint64_t key, std::uint32_t amount = 1);
+
+    // Returns the estimated count for the given key.
+    std::uint32_t estimate(std::uint64_t key) const;
+
+    // Returns the memory used by the counters, in bytes.
+    std::size_t getMemoryUsage() const;
+
+    // Saves the counters to a binary stream.
+    void save(std::ostream& os) const;
+
+    // Loads the counters from a binary stream. Returns false if the stream
+    // does not contain a sketch with the same dimensions.
+    bool load(std::istream& is);
+
+private:
+    // Returns the index of the counter for the given key in the given row.
+    std::size_t index(std::uint64_t key, int row) const;
+};
+}
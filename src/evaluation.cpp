@@ -0,0 +1,333 @@
+#include "evaluation.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <ale/ale_interface.hpp>
+
+#include "agent-factory.h"
+#include "child-process.h"
+#include "random-engine.h"
+#include "sequential-test.h"
+#include "shared-q-table.h"
+
+namespace Qbert {
+
+// A game with the agent that plays it.
+struct Game
+{
+    std::unique_ptr<ALEInterface> ale;
+    std::unique_ptr<Agent> agent;
+};
+
+// Creates the given number of games with the agent given by the arguments.
+// The games and agents are created up front, since creating the agents may
+// merge and load tables.
+static std::vector<Game> createGames(const Args& args, int count)
+{
+    std::vector<Game> games(count);
+    for (auto& game : games)
+    {
+        game.ale = std::make_unique<ALEInterface>();
+        game.ale->setInt("random_seed", args.randomSeed);
+        game.ale->loadROM(args.rom);
+        game.agent = createAgent(*game.ale, args);
+    }
+    return games;
+}
+
+void reseedEmulator(ALEInterface& ale, const std::string& rom, int seed)
+{
+    // The emulator only reads its seed when a ROM is loaded, and loading it
+    // also resets the game.
+    seedRandomEngine(seed);
+    ale.setInt("random_seed", seed);
+    ale.loadROM(rom);
+}
+
+// Starts a new game of the given ROM from the given seed.
+static void reseedGame(Game& game, const std::string& rom, int seed)
+{
+    reseedEmulator(*game.ale, rom, seed);
+    game.agent->resetGame();
+}
+
+// Plays the current episode of the given game to the end, and returns the
+// number of frames played.
+static long playEpisode(Game& game)
+{
+    long frames = 0;
+    while (!game.ale->game_over())
+        frames += game.agent->updateState();
+    return frames;
+}
+
+// The seeds of an evaluation, dealt out to a queue for each worker. A worker
+// takes the seeds from the back of its own queue, and steals them from the
+// front of the other queues once its own is empty, so that the workers that
+// get short games don't sit idle at the end.
+class SeedQueues
+{
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<int> seeds;
+    };
+
+    std::vector<Queue> queues;
+
+public:
+    // Deals the given number of seeds, starting at the given one, to the
+    // given number of workers in contiguous blocks.
+    SeedQueues(int workers, int firstSeed, int seeds) : queues(workers)
+    {
+        for (int i = 0; i < seeds; ++i)
+            queues[static_cast<long>(i) * workers / seeds].seeds.push_back(
+                firstSeed + i);
+    }
+
+    // Takes the next seed for the given worker. Returns false once all the
+    // queues are empty.
+    bool take(int worker, int& seed, bool& isStolen)
+    {
+        int workers = static_cast<int>(queues.size());
+        for (int i = 0; i < workers; ++i)
+        {
+            auto& queue = queues[(worker + i) % workers];
+            std::lock_guard<std::mutex> lock{queue.mutex};
+            if (queue.seeds.empty())
+                continue;
+            isStolen = i > 0;
+            if (isStolen)
+            {
+                seed = queue.seeds.front();
+                queue.seeds.pop_front();
+            }
+            else
+            {
+                seed = queue.seeds.back();
+                queue.seeds.pop_back();
+            }
+            return true;
+        }
+        return false;
+    }
+};
+
+ScoreStatistics evaluateSeeds(const Args& args)
+{
+    int workers = std::min(getWorkerCount(args.workers), args.seeds);
+    SharedTables tables{args.learnerConfig};
+    auto workerArgs = args;
+    workerArgs.learnerConfig.sharedTables = &tables;
+    auto games = createGames(workerArgs, workers);
+
+    SeedQueues queues{workers, args.randomSeed, args.seeds};
+    std::mutex mutex;
+    ScoreStatistics statistics;
+    int finishedSeeds = 0;
+    int stolenSeeds = 0;
+    auto play = [&](int worker) {
+        auto& game = games[worker];
+        auto& agent = *game.agent;
+        int seed;
+        bool isStolen;
+        while (queues.take(worker, seed, isStolen))
+        {
+            reseedGame(game, args.rom, seed);
+            ScoreStatistics seedStatistics;
+            for (int episode = 0; episode < args.episodes; ++episode)
+            {
+                playEpisode(game);
+                seedStatistics.add(agent.getScore(), agent.getLevel());
+                {
+                    std::lock_guard<std::mutex> lock{mutex};
+                    statistics.add(agent.getScore(), agent.getLevel());
+                }
+                game.ale->reset_game();
+                agent.resetGame();
+            }
+
+            std::lock_guard<std::mutex> lock{mutex};
+            ++finishedSeeds;
+            stolenSeeds += isStolen;
+            std::cout << "Seed " << seed << ": mean score "
+                      << seedStatistics.getMean() << " over " << args.episodes
+                      << " episodes (" << finishedSeeds << "/" << args.seeds
+                      << (isStolen ? ", stolen" : "") << ")." << std::endl;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; ++i)
+        threads.emplace_back(play, i);
+    for (auto& thread : threads)
+        thread.join();
+    std::cout << "Stole " << stolenSeeds << " of " << args.seeds
+              << " seeds between " << workers << " workers." << std::endl;
+    return statistics;
+}
+
+void evaluate(const Args& args)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto statistics = evaluateSeeds(args);
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    auto format = [](double value, int precision) {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(precision) << value;
+        return os.str();
+    };
+    // The levels are numbered from 1 in the table, as they are in the game.
+    std::vector<std::pair<std::string, std::string>> columns{
+        {"Learner", args.learner + "-" + args.explorationPolicy.first},
+        {"Episodes", std::to_string(statistics.getCount())},
+        {"Mean", format(statistics.getMean(), 1)},
+        {"Std Dev", format(statistics.getStandardDeviation(), 1)},
+        {"Min", format(statistics.getMin(), 0)},
+        {"P10", format(statistics.getQuantile(0.1), 0)},
+        {"Median", format(statistics.getQuantile(0.5), 0)},
+        {"P90", format(statistics.getQuantile(0.9), 0)},
+        {"Max", format(statistics.getMax(), 0)},
+        {"Max Level", std::to_string(statistics.getMaxLevel() + 1)},
+        {"Seconds", format(seconds, 1)}};
+    std::cout << std::left;
+    for (const auto& column : columns)
+    {
+        auto width = std::max(column.first.size(), column.second.size()) + 2;
+        std::cout << std::setw(width) << column.first;
+    }
+    std::cout << std::endl;
+    for (const auto& column : columns)
+    {
+        auto width = std::max(column.first.size(), column.second.size()) + 2;
+        std::cout << std::setw(width) << column.second;
+    }
+    std::cout << std::endl;
+}
+
+void compare(const Args& args)
+{
+    auto start = std::chrono::steady_clock::now();
+    int workers = std::min(getWorkerCount(args.workers), args.episodes);
+    SharedTables tables{args.learnerConfig};
+    std::array<Args, 2> sideArgs{{args, args}};
+    sideArgs[1].learner = args.versusLearner;
+    sideArgs[1].explorationPolicy = args.versusPolicy;
+    std::array<std::string, 2> names;
+    std::array<std::vector<Game>, 2> games;
+    for (int side = 0; side < 2; ++side)
+    {
+        sideArgs[side].learnerConfig.sharedTables = &tables;
+        names[side] = sideArgs[side].learner + "-" +
+            sideArgs[side].explorationPolicy.first;
+        games[side] = createGames(sideArgs[side], workers);
+    }
+
+    // The episodes of a pair start from the same seed.
+    struct PairResult
+    {
+        std::array<float, 2> scores;
+        std::array<int, 2> levels;
+        long frames{0};
+    };
+
+    SequentialTest test{args.significance};
+    std::array<ScoreStatistics, 2> statistics;
+    std::mutex mutex;
+    std::atomic<bool> stop{false};
+    std::atomic<int> nextPair{0};
+    std::map<int, PairResult> pending;
+    int appliedPairs = 0;
+    long appliedFrames = 0;
+    long totalFrames = 0;
+    auto play = [&](int worker) {
+        while (!stop)
+        {
+            int pair = nextPair++;
+            if (pair >= args.episodes)
+                return;
+            PairResult result;
+            for (int side = 0; side < 2; ++side)
+            {
+                auto& game = games[side][worker];
+                reseedGame(game, args.rom, args.randomSeed + pair);
+                result.frames += playEpisode(game);
+                result.scores[side] = game.agent->getScore();
+                result.levels[side] = game.agent->getLevel();
+            }
+
+            // The pairs are tested in the order of their seeds, so that the
+            // order doesn't depend on how long the games take. The pairs that
+            // finish after the test stops still count as frames played.
+            std::lock_guard<std::mutex> lock{mutex};
+            totalFrames += result.frames;
+            pending[pair] = result;
+            while (!stop && !pending.empty() &&
+                   pending.begin()->first == appliedPairs)
+            {
+                const auto& next = pending.begin()->second;
+                for (int side = 0; side < 2; ++side)
+                    statistics[side].add(next.scores[side], next.levels[side]);
+                test.add(next.scores[0] - next.scores[1]);
+                appliedFrames += next.frames;
+                pending.erase(pending.begin());
+                ++appliedPairs;
+                if (test.isSignificant() || appliedPairs == args.episodes)
+                    stop = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; ++i)
+        threads.emplace_back(play, i);
+    for (auto& thread : threads)
+        thread.join();
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    for (int side = 0; side < 2; ++side)
+        std::cout << (side == 0 ? "A: " : "B: ") << names[side]
+                  << ", mean score " << statistics[side].getMean()
+                  << " (std dev " << statistics[side].getStandardDeviation()
+                  << ", median " << statistics[side].getQuantile(0.5)
+                  << ")" << std::endl;
+    std::cout << "Pairs: " << appliedPairs << " of " << args.episodes
+              << std::endl;
+    std::cout << "Difference (A - B): " << test.getMean() << " +/- "
+              << test.getConfidenceRadius() << " with confidence "
+              << 1 - args.significance << std::endl;
+    if (!test.isSignificant())
+        std::cout << "Result: no significant difference within the budget."
+                  << std::endl;
+    else
+        std::cout << "Result: " << (test.getMean() > 0 ? "A" : "B")
+                  << " scores higher." << std::endl;
+
+    // A run of fixed size would have played every pair in the budget, at the
+    // mean cost of the pairs that were played.
+    double fixedFrames =
+        static_cast<double>(appliedFrames) / appliedPairs * args.episodes;
+    std::cout << "Frames: " << totalFrames << " in " << seconds << " s"
+              << std::endl;
+    std::cout << "Frames Saved: " << fixedFrames - totalFrames << " ("
+              << 100 * (1 - totalFrames / fixedFrames)
+              << "% of a run of fixed size)" << std::endl;
+}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+
+#include <ale/ale_interface.hpp>
+
+#include "args.h"
+#include "score-statistics.h"
+
+namespace Qbert {
+
+// Plays args.episodes episodes of the frozen agent given by the arguments
+// from each of args.seeds seeds, starting at args.randomSeed, and returns the
+// statistics of their scores. The seeds are spread over args.workers threads,
+// or one per core if it is 0, which share the agent's tables. Each thread
+// plays the seeds dealt to it, and steals the seeds of the others once it
+// runs out.
+ScoreStatistics evaluateSeeds(const Args& args);
+
+// Starts a new game of the given ROM in the given emulator from the given
+// seed, and seeds the random engine of the current thread with it.
+void reseedEmulator(ALEInterface& ale, const std::string& rom, int seed);
+
+// Evaluates the agent given by the arguments over several seeds and prints a
+// summary of the scores.
+void evaluate(const Args& args);
+
+// Compares the frozen agent given by the arguments with the one given by
+// args.versusLearner and args.versusPolicy. The agents play pairs of episodes
+// from the same seeds, starting at args.randomSeed, on args.workers threads,
+// or one per core if it is 0. A sequential test of the differences between
+// their scores stops the comparison as soon as one agent is significantly
+// better, or after args.episodes pairs. Prints the result and the frames saved
+// compared to playing every pair.
+void compare(const Args& args);
+}
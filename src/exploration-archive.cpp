@@ -0,0 +1,111 @@
+#include "exploration-archive.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "checkpoint.h"
+#include "random-engine.h"
+
+namespace Qbert {
+
+ExplorationArchive::ExplorationArchive(std::string path) : path{path}
+{
+}
+
+void ExplorationArchive::update(ALEInterface& ale, Agent& agent)
+{
+    auto& cell = cells[agent.getCell()];
+    ++cell.visits;
+    if (cell.visits > 1 && agent.getScore() <= cell.score)
+        return;
+
+    if (cell.visits == 1)
+        ++discoveries;
+    cell.systemState = ale.cloneSystemState().serialize();
+    std::ostringstream os;
+    agent.saveProgress(os);
+    cell.progress = os.str();
+    cell.score = agent.getScore();
+}
+
+bool ExplorationArchive::restore(ALEInterface& ale, Agent& agent)
+{
+    if (cells.empty())
+        return false;
+
+    auto getWeight = [](const ArchiveCell& cell) {
+        return 1 / std::sqrt(cell.visits + 1.0f);
+    };
+    float totalWeight = 0;
+    for (const auto& p : cells)
+        totalWeight += getWeight(p.second);
+
+    // The last cell absorbs any rounding left in the choice.
+    float choice = getRandomFloat() * totalWeight;
+    auto chosen = cells.begin();
+    for (auto it = cells.begin(); it != cells.end(); ++it)
+    {
+        chosen = it;
+        choice -= getWeight(it->second);
+        if (choice < 0)
+            break;
+    }
+
+    auto& cell = chosen->second;
+    ++cell.visits;
+    ale.restoreSystemState(ALEState{cell.systemState});
+    std::istringstream is{cell.progress};
+    agent.restoreProgress(is);
+    return true;
+}
+
+std::size_t ExplorationArchive::size() const
+{
+    return cells.size();
+}
+
+void ExplorationArchive::save() const
+{
+    std::ofstream os{path + ".temp", std::ios::binary};
+    os << cells.size() << std::endl;
+    for (const auto& p : cells)
+    {
+        os << p.first << " " << p.second.score << " " << p.second.visits
+           << std::endl;
+        writeString(os, p.second.systemState);
+        writeString(os, p.second.progress);
+    }
+    os.close();
+    rename((path + ".temp").c_str(), path.c_str());
+}
+
+bool ExplorationArchive::load()
+{
+    std::ifstream is{path, std::ios::binary};
+    if (!is)
+        return false;
+    cells.clear();
+    std::size_t count;
+    is >> count;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::uint64_t key;
+        ArchiveCell cell;
+        is >> key >> cell.score >> cell.visits;
+        readString(is, cell.systemState);
+        readString(is, cell.progress);
+        cells[key] = cell;
+    }
+    if (!is)
+        throw std::runtime_error{"invalid archive " + path};
+    return true;
+}
+
+int ExplorationArchive::getDiscoveries() const
+{
+    return discoveries;
+}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include <ale/ale_interface.hpp>
+
+#include "agent.h"
+
+namespace Qbert {
+
+// A distinct situation reached by the agent, with the game that reached it.
+struct ArchiveCell
+{
+    // The emulator state, as given by ALEInterface::cloneSystemState.
+    std::string systemState;
+
+    // The progress of the agent, as written by Agent::saveProgress.
+    std::string progress;
+
+    // The score of the game that reached the cell.
+    float score{0};
+
+    // The number of times the cell was reached or returned to.
+    int visits{0};
+};
+
+// An archive of the cells reached by the agent, in the style of Go-Explore.
+// Games return to the rarely visited cells instead of starting over, so that
+// fewer frames are spent reaching the situations that are already known.
+class ExplorationArchive
+{
+    std::string path;
+    std::unordered_map<std::uint64_t, ArchiveCell> cells;
+    int discoveries{0};
+
+public:
+    // Creates an empty archive that is saved to the given path.
+    explicit ExplorationArchive(std::string path);
+
+    // Adds the agent's current cell to the archive, or counts a visit to it.
+    // Each cell keeps the game that reached it with the highest score.
+    void update(ALEInterface& ale, Agent& agent);
+
+    // Restores a game that was just reset to a cell chosen at random, with a
+    // weight of one over the square root of its visits plus one. Returns false
+    // if the archive is empty and the game starts from the beginning.
+    bool restore(ALEInterface& ale, Agent& agent);
+
+    // Returns the number of cells in the archive.
+    std::size_t size() const;
+
+    // Writes the cells to the archive's file. The file is replaced
+    // atomically, so that an interrupted run keeps the previous archive.
+    void save() const;
+
+    // Replaces the cells with the ones in the archive's file. Returns false if
+    // there is no file.
+    bool load();
+
+    // Returns the number of cells added to the archive.
+    int getDiscoveries() const;
+};
+}
@@ -1,6 +1,8 @@
 #include "exploration-policy.h"
 
-#include <cstdlib>
+#include <limits>
+
+#include "random-engine.h"
 
 namespace Qbert {
 
@@ -10,13 +12,16 @@ ExploreEpsilonGreedy::ExploreEpsilonGreedy(float eps) : eps{eps}
 
 bool ExploreEpsilonGreedy::operator()(int /*visitCount*/)
 {
-    float r = static_cast<float>(rand()) / RAND_MAX;
-    return r <= eps;
+    return getRandomFloat() < eps;
 }
 
 bool ExploreInverseProportional::operator()(int visitCount)
 {
-    return rand() % (visitCount + 1) == 0;
+    // The probability is negligible at the maximum count, where the count of
+    // outcomes would overflow.
+    if (visitCount == std::numeric_limits<int>::max())
+        return false;
+    return getRandomInt(visitCount + 1) == 0;
 }
 
 ExploreThreshold::ExploreThreshold(int threshold) : threshold{threshold}
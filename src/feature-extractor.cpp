@@ -295,6 +295,14 @@ Color getGoalColor(const ALEScreen& screen)
     return counts.empty() ? 0 : getMaxColor(counts);
 }
 
+bool isAcceptingAction(ALEInterface& ale)
+{
+    // The combination of the first byte in RAM being 0 and the last bit in RAM
+    // being 1 is a good signal for the game accepting actions from the player.
+    auto ram = ale.getRAM();
+    return ram.get(0x00) == 0 && (ram.get(0x7F) & 0x01) == 1;
+}
+
 Color getBackground(const ALEScreen& screen)
 {
     auto xScale = width / screen.width();
@@ -25,4 +25,8 @@ StateType getState(ALEInterface& ale);
 // that this method can fail and return 0 if the score is currently not being
 // displayed.
 Color getGoalColor(const ALEScreen& screen);
+
+// Is the game accepting an action from the player that will actually have an
+// effect on the game?
+bool isAcceptingAction(ALEInterface& ale);
 }
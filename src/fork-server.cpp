@@ -0,0 +1,114 @@
+#include "fork-server.h"
+
+#include <cerrno>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <set>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "agent-factory.h"
+#include "child-process.h"
+#include "evaluation.h"
+
+namespace Qbert {
+
+// Returns the number of milliseconds since the given time.
+static double getMilliseconds(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - since)
+        .count();
+}
+
+// Runs a job in the current process, which was just forked from the server.
+static void runJobProcess(
+    const Args& args,
+    ALEInterface& ale,
+    Agent& agent,
+    int job,
+    int seed,
+    const std::string& results,
+    std::chrono::steady_clock::time_point requested,
+    std::chrono::steady_clock::time_point forked,
+    const ForkJob& runJob)
+{
+    auto jobArgs = args;
+    jobArgs.randomSeed = seed;
+    reseedEmulator(ale, args.rom, seed);
+
+    double waited =
+        std::chrono::duration<double, std::milli>(forked - requested).count();
+    std::cout << "Job " << job << " (seed " << seed << ") started in "
+              << getMilliseconds(forked) << " ms, after waiting " << waited
+              << " ms for a free worker." << std::endl;
+    runJob(jobArgs, ale, agent, results);
+}
+
+void serveForks(const Args& args, const ForkJob& runJob)
+{
+    auto start = std::chrono::steady_clock::now();
+    ALEInterface ale;
+    ale.setInt("random_seed", args.randomSeed);
+    ale.setBool("display_screen", false);
+    ale.setBool("sound", false);
+    ale.loadROM(args.rom);
+    auto agent = createAgent(ale, args);
+    std::cout << "Loaded the ROM and the tables in " << getMilliseconds(start)
+              << " ms. Reading jobs as <seed> <results file> lines."
+              << std::endl;
+
+    int maxJobs = getWorkerCount(args.workers);
+    std::set<pid_t> jobs;
+    // Collects a finished job, waiting for one unless the options say
+    // otherwise. Returns false if there was none.
+    auto collectJob = [&](int options) {
+        pid_t pid = waitpid(-1, nullptr, options);
+        if (pid > 0)
+            jobs.erase(pid);
+        else if (pid < 0 && errno == ECHILD)
+            jobs.clear();
+        return pid > 0;
+    };
+
+    int job = 0;
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        auto requested = std::chrono::steady_clock::now();
+        std::istringstream is{line};
+        int seed;
+        std::string results;
+        if (!(is >> seed >> results))
+        {
+            if (!line.empty())
+                std::cerr << "Error: invalid job: " << line << std::endl;
+            continue;
+        }
+
+        while (collectJob(WNOHANG))
+            continue;
+        while (static_cast<int>(jobs.size()) >= maxJobs)
+            collectJob(0);
+
+        ++job;
+        auto forked = std::chrono::steady_clock::now();
+        jobs.insert(runInChild("job " + std::to_string(job), [&]() {
+            runJobProcess(
+                args,
+                ale,
+                *agent,
+                job,
+                seed,
+                results,
+                requested,
+                forked,
+                runJob);
+        }));
+    }
+    while (!jobs.empty())
+        collectJob(0);
+}
+}
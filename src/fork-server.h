@@ -0,0 +1,31 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include <ale/ale_interface.hpp>
+
+#include "agent.h"
+#include "args.h"
+
+namespace Qbert {
+
+// A function that runs a job of the fork server with the given arguments,
+// game, and agent, and writes its results to the file at the given path.
+using ForkJob = std::function<void(
+    const Args& args,
+    ALEInterface& ale,
+    Agent& agent,
+    const std::string& results)>;
+
+// Loads the ROM and the learners' tables given by the arguments once, then
+// reads jobs from std::cin, one per line, each made of a random seed and a
+// results file. Each job runs runJob in a forked process that inherits the
+// game and the tables copy-on-write and reseeds them with its own seed, so
+// that it can start playing right away. The time that each job takes to start
+// is reported, along with the time it waited for a free worker.
+//
+// At most args.workers jobs run at once, or one per core if it is 0. The
+// server returns once std::cin is closed and all the jobs are done.
+void serveForks(const Args& args, const ForkJob& runJob);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+namespace Qbert {
+
+class SharedTables;
+class ActorLearnerHub;
+
+// Defines which states are evicted first when a table is over its budget.
+enum class EvictionPolicy
+{
+    LeastRecentlyUsed,
+    LeastVisited
+};
+
+// Defines how the writes to a table shared between threads are synchronized.
+enum class TableSync
+{
+    Atomic,
+    Striped
+};
+
+// Settings that control how a learner learns and stores its tables.
+struct LearnerConfig
+{
+    // The learning rate.
+    float alpha{0.10f};
+
+    // The discount factor of the future rewards.
+    float gamma{0.90f};
+
+    // The number of slots in the direct-mapped cache that sits in front of the
+    // main table. This is rounded up to a power of two, and 0 disables it.
+    int cacheSize{256};
+
+    // The largest cache size accepted, which keeps the rounding from
+    // overflowing.
+    static constexpr int maxCacheSize = 1 << 24;
+
+    // The maximum number of states kept in memory, or 0 for no limit.
+    int maxStates{0};
+
+    // The largest state limit accepted, which keeps the capacity of the shared
+    // tables from overflowing.
+    static constexpr int maxStatesLimit = 1 << 28;
+
+    // The maximum memory used by the table in megabytes, or 0 for no limit.
+    // This is converted to a number of states, and the stricter of the two
+    // limits is used.
+    float maxTableMegabytes{0};
+
+    // The largest table size accepted, in megabytes.
+    static constexpr float maxTableMegabytesLimit = 1 << 20;
+
+    // The policy used to choose which states to evict.
+    EvictionPolicy eviction{EvictionPolicy::LeastRecentlyUsed};
+
+    // Whether evicted states are kept in a spill file so that they are still
+    // saved with the table.
+    bool spill{false};
+
+    // The number of counters in each row of the count-min sketch used for the
+    // visit counts, or 0 to keep exact visit counts in the table.
+    int sketchWidth{0};
+
+    // The number of rows in the count-min sketch.
+    int sketchDepth{4};
+
+    // Whether exact visit counts are kept alongside the sketch to measure how
+    // often the approximation changes the exploration decision.
+    bool validateSketch{false};
+
+    // Whether the learner is frozen for evaluation. A frozen learner never
+    // updates or saves its table, and explores with probability evalEpsilon
+    // instead of following its exploration policy.
+    bool frozen{false};
+
+    // The probability of a random action for a frozen learner.
+    float evalEpsilon{0};
+
+    // Whether the table is trained without ever being saved, so that a run
+    // that only measures the speed of training leaves the param files as they
+    // were.
+    bool discardTable{false};
+
+    // Whether the rows of the states that each move could lead to are
+    // prefetched while the emulator plays the move. The learner then reports
+    // how long its lookups take with and without a prefetch.
+    bool prefetchSuccessors{false};
+
+    // The tables shared with the learners of other threads, or null for a
+    // learner that has a table of its own. A shared table holds up to
+    // maxStates states, and ignores the other table settings.
+    SharedTables* sharedTables{nullptr};
+
+    // How the writes to a shared table are synchronized.
+    TableSync tableSync{TableSync::Atomic};
+
+    // The hub that connects an actor's learner to the master learner of the
+    // same name, or null for a learner that updates its table directly. An
+    // actor's learner reads a snapshot of its master's table and sends its
+    // updates to the master, which uses the other table settings.
+    ActorLearnerHub* actorLearnerHub{nullptr};
+};
+}
@@ -1,114 +1,342 @@
 #include "learner.h"
 
 #include <fstream>
+#include <algorithm>
 #include <cstdio>
-#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <thread>
 
 #include "game-entity.h"
+#include "action-selection.h"
+#include "param-file.h"
+#include "random-engine.h"
 
 namespace Qbert {
 
+// One in this many lookups is timed when measuring the prefetches.
+static constexpr long lookupSampleInterval = 64;
+
+// Returns the exploration policy that a learner with the given settings uses. A
+// frozen learner ignores its visit counts and explores with a fixed epsilon,
+// and never explores at all when epsilon is 0.
+static ExplorationPolicy
+    getExplorationPolicy(ExplorationPolicy explore, const LearnerConfig& config)
+{
+    if (!config.frozen)
+        return explore;
+    if (config.evalEpsilon > 0)
+        return ExploreEpsilonGreedy{config.evalEpsilon};
+    return ExploreThreshold{0};
+}
+
 Learner::Learner(
     std::string name,
     StateEncoding encodeState,
     ExplorationPolicy explore,
-    float alpha,
-    float gamma)
+    const LearnerConfig& config)
     : name{name},
       encodeState{encodeState},
-      explore{explore},
-      alpha{alpha},
-      gamma{gamma}
+      explore{getExplorationPolicy(explore, config)},
+      alpha{config.alpha},
+      gamma{config.gamma},
+      frozen{config.frozen},
+      discardTable{config.discardTable},
+      table{config},
+      validateSketch{
+          !config.frozen && config.sketchWidth > 0 && config.validateSketch},
+      isPrefetchingSuccessors{config.prefetchSuccessors}
 {
+    // An actor's learner uses the table of its master instead of its own.
+    if (config.actorLearnerHub)
+    {
+        auto connection = config.actorLearnerHub->connect(name, [&]() {
+            auto masterConfig = config;
+            masterConfig.actorLearnerHub = nullptr;
+            return std::make_unique<Learner>(
+                name, encodeState, explore, masterConfig);
+        });
+        queue = connection.first;
+        channel = connection.second;
+        channel->refresh(snapshot);
+        return;
+    }
+
+    // A shared table is loaded and saved by its owner, and doesn't support the
+    // sketch or the spill file.
+    if (config.sharedTables)
+    {
+        sharedTable = config.sharedTables->get(name);
+        return;
+    }
+
+    // A frozen learner only reads the utilities, so it uses the exported
+    // policy artifact when there is an up to date one, instead of building a
+    // table from the param file.
+    if (frozen && PolicyArtifact::isCurrent(name))
+    {
+        policy = std::make_unique<const PolicyArtifact>(
+            PolicyArtifact::getPath(name));
+        return;
+    }
+
+    // A frozen learner only needs the utilities, so it skips the sketch.
+    if (config.sketchWidth > 0 && !frozen)
+        sketch = std::make_unique<CountMinSketch>(
+            config.sketchWidth, config.sketchDepth);
+
+    // The spill file only holds the states evicted during this run, since the
+    // ones evicted in previous runs were saved with the rest of the table. A
+    // spilled state is read back into the table the next time it is needed.
+    if (config.spill && !frozen)
+    {
+        spill.open(
+            "params/" + name + ".param.spill",
+            std::ios::in | std::ios::out | std::ios::trunc);
+        // The rows can be read back many times, so they are written exactly.
+        spill.precision(std::numeric_limits<float>::max_digits10);
+        table.setEvictionHandler([this](int state, const QEntry& entry) {
+            spillEntry(state, entry);
+        });
+        table.setMissHandler([this](int state, QEntry& entry) {
+            return unspillEntry(state, entry);
+        });
+    }
     loadFromFile();
 }
 
-void Learner::update(
+int Learner::encode(
     std::pair<int, int> position,
     const StateType& state,
-    const Action& actionPerformed,
-    float reward,
     Color startColor,
     Color goalColor,
-    int level)
+    int level) const
 {
-    lastState = currentState;
-    currentState = encodeState(
+    return encodeState(
         state, position.first, position.second, startColor, goalColor, level);
+}
 
-    if (lastState != -1)
-    {
-        int actionIndex = actionToIndex(currentAction);
-        auto q = utilities[lastState][actionIndex];
-        auto actions = getActions(position, state);
-        auto qMax = utilities[currentState][actionToIndex(*std::max_element(
-            actions.begin(), actions.end(), [&](Action lhs, Action rhs) {
-                return utilities[currentState][actionToIndex(lhs)] <
-                    utilities[currentState][actionToIndex(rhs)];
-            }))];
-        utilities[lastState][actionIndex] +=
-            alpha * (reward + gamma * qMax - q);
-    }
+void Learner::update(
+    int encodedState, int mask, const Action& actionPerformed, float reward)
+{
+    if (frozen)
+        return;
+
+    lastState = currentState;
+    // A state without valid actions is left with a NOOP, which has no row to
+    // update or visit, so the learner treats it like the start of a game.
+    currentState = mask == 0 ? -1 : encodedState;
+
+    Transition transition;
+    transition.state = lastState;
+    transition.action = actionToIndex(currentAction);
+    transition.reward = reward;
+    transition.nextState = currentState;
+    transition.nextMask = mask;
+    transition.nextAction = actionToIndex(actionPerformed);
+    record(transition);
 
     lastAction = currentAction;
     currentAction = actionPerformed;
-    ++visited[currentState][actionToIndex(currentAction)];
-    if (visited[currentState][actionToIndex(currentAction)] == 1000000000)
-        --visited[currentState][actionToIndex(currentAction)]; // Avoids
-                                                               // overflow.
 }
 
 void Learner::correctUpdate(float reward)
 {
-    if (lastState != -1)
+    if (lastState != -1 && reward != 0 && !frozen)
     {
-        int actionIndex = actionToIndex(lastAction);
-        utilities[lastState][actionIndex] += alpha * reward;
+        Transition transition;
+        transition.type = Transition::Correction;
+        transition.state = lastState;
+        transition.action = actionToIndex(lastAction);
+        transition.reward = reward;
+        record(transition);
     }
 }
 
-Action Learner::getAction(
-    std::pair<int, int> position,
-    const StateType& state,
-    Color startColor,
-    Color goalColor,
-    int level)
+void Learner::applyTransition(const Transition& transition)
 {
-    auto currentState = encodeState(
-        state, position.first, position.second, startColor, goalColor, level);
-    auto actions = getActions(position, state);
+    if (transition.type == Transition::Correction)
+    {
+        addUtility(
+            transition.state, transition.action, alpha * transition.reward);
+        return;
+    }
+
+    if (transition.state != -1)
+    {
+        QEntry buffer;
+        auto q =
+            findEntry(transition.state, buffer).utilities[transition.action];
+        // A state without valid actions is treated as terminal, since the
+        // maximum over no actions is -inf.
+        float qMax = 0;
+        if (transition.nextMask != 0)
+        {
+            const auto& entry = findEntry(transition.nextState, buffer);
+            qMax = selectActions(
+                       entry.utilities.data(),
+                       entry.visited.data(),
+                       transition.nextMask)
+                       .maxUtility;
+        }
+        // We only materialize a row when the update actually changes it.
+        float delta = alpha * (transition.reward + gamma * qMax - q);
+        if (delta != 0)
+            addUtility(transition.state, transition.action, delta);
+    }
+
+    if (transition.nextState == -1)
+        return;
+    if (sketch)
+        sketch->add(getSketchKey(transition.nextState, transition.nextAction));
+    if (!sketch || validateSketch)
+        addVisit(transition.nextState, transition.nextAction);
+}
 
-    int minVisited = visited[currentState][actionToIndex(*std::min_element(
-        actions.begin(), actions.end(), [&](Action lhs, Action rhs) {
-            return visited[currentState][actionToIndex(lhs)] <
-                visited[currentState][actionToIndex(rhs)];
-        }))];
+ParamTable Learner::createSnapshot()
+{
+    ParamTable entries;
+    auto copy = [&](int state, const QEntry& entry) { entries[state] = entry; };
+    if (sharedTable)
+        sharedTable->forEach(copy);
+    else
+        table.forEach(copy);
+    return entries;
+}
+
+Action Learner::getAction(int encodedState, int mask)
+{
+    // Without a valid action there is nothing to look up or choose.
+    if (mask == 0)
+    {
+        isRandomAction = false;
+        return Action::PLAYER_A_NOOP;
+    }
+
+    if (channel)
+    {
+        channel->refresh(snapshot);
+        snapshotStaleness += channel->getApplied() - snapshot->version;
+        ++snapshotDecisions;
+    }
+
+    QEntry buffer;
+    // Reading the clock costs about as much as the lookup itself, so only a
+    // sample of the lookups is timed.
+    bool isTimed = isPrefetchingSuccessors &&
+        ++lookupCount % lookupSampleInterval == 0;
+    std::chrono::steady_clock::time_point start;
+    if (isTimed)
+        start = std::chrono::steady_clock::now();
+    const auto& entry = findEntry(encodedState, buffer);
+    if (isPrefetchingSuccessors)
+    {
+        double time = -1;
+        if (isTimed)
+            time = std::chrono::duration<double, std::nano>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+        recordLookup(encodedState, time);
+    }
+    alignas(16) QEntry::VisitRow sketchCounts;
+    if (sketch)
+        getSketchCounts(encodedState, sketchCounts);
+    auto selection = selectActions(
+        entry.utilities.data(),
+        sketch ? sketchCounts.data() : entry.visited.data(),
+        mask);
+    // Only a count that differs from the exact one can change the decision.
+    // The exploration policy is then replayed on the exact count from the same
+    // random engine state, so that both decisions use the same random draws.
+    int exactMinVisited = validateSketch
+        ? selectActions(entry.utilities.data(), entry.visited.data(), mask)
+              .minVisited
+        : selection.minVisited;
+    bool isCountWrong = exactMinVisited != selection.minVisited;
+    if (isCountWrong)
+        replayEngine = getRandomEngine();
+    bool isExploring = explore(selection.minVisited);
+    if (validateSketch)
+    {
+        ++sketchDecisions;
+        if (isCountWrong)
+        {
+            ++sketchCountErrors;
+            std::swap(getRandomEngine(), replayEngine);
+            if (explore(exactMinVisited) != isExploring)
+                ++sketchDecisionChanges;
+            std::swap(getRandomEngine(), replayEngine);
+        }
+    }
 
     // If we didn't explore the actions in this state enough, we choose a random
     // action to allow the agent more opportunity to learn.
-    if (explore(minVisited))
+    if (isExploring)
     {
-        auto tentativeAction = actions[rand() % actions.size()];
+        auto tentativeAction = indexToAction(
+            getNthAction(mask, getRandomInt(countActions(mask))));
         isRandomAction = true;
         return tentativeAction;
     }
     else
     {
-        auto qMax = utilities[currentState][actionToIndex(*std::max_element(
-            actions.begin(), actions.end(), [&](Action lhs, Action rhs) {
-                return utilities[currentState][actionToIndex(lhs)] <
-                    utilities[currentState][actionToIndex(rhs)];
-            }))];
-        std::vector<Action> bestActions;
-        for (auto action : actions)
-            if (utilities[currentState][actionToIndex(action)] == qMax)
-                bestActions.push_back(action);
-        auto tentativeAction = bestActions[rand() % bestActions.size()];
+        auto tentativeAction = indexToAction(getNthAction(
+            selection.bestMask,
+            getRandomInt(countActions(selection.bestMask))));
         isRandomAction = false;
         return tentativeAction;
     }
 }
 
+void Learner::prefetch(int encodedState)
+{
+    prefetchRow(encodedState);
+}
+
+void Learner::prefetchSuccessors(
+    std::pair<int, int> position,
+    const StateType& state,
+    Color startColor,
+    Color goalColor,
+    int level)
+{
+    if (!isPrefetchingSuccessors)
+        return;
+
+    // The moves in the same order as the utility rows.
+    static const std::pair<int, int> moves[4]{{-1, 0}, {0, 1}, {0, -1}, {1, 0}};
+    int mask = getActionMask(position, state);
+    successorCount = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if ((mask & (1 << i)) == 0)
+            continue;
+        // The block that Qbert lands on is assumed to take the goal color,
+        // which is what happens on the first level.
+        int x = position.first + moves[i].first;
+        int y = position.second + moves[i].second;
+        auto successor = state;
+        successor.first[position.first][position.second] = GameEntity::None;
+        successor.first[x][y] = GameEntity::Qbert;
+        successor.second[x][y] = goalColor;
+        successors[successorCount] =
+            encodeState(successor, x, y, startColor, goalColor, level);
+        prefetchRow(successors[successorCount]);
+        ++successorCount;
+    }
+}
+
+QEntry::UtilityRow Learner::getUtilities(int encodedState)
+{
+    QEntry buffer;
+    return findEntry(encodedState, buffer).utilities;
+}
+
+bool Learner::wasRandomAction()
+{
+    return isRandomAction;
+}
+
 void Learner::notifyActionTaken()
 {
     if (isRandomAction)
@@ -116,24 +344,137 @@ void Learner::notifyActionTaken()
     ++totalActionCount;
 }
 
-std::vector<Action>
-    Learner::getActions(std::pair<int, int> position, const StateType& state)
+int Learner::getActionMask(
+    std::pair<int, int> position, const StateType& state)
 {
-    std::vector<Action> actions;
+    int mask = 0;
     if (state.first[position.first - 1][position.second] != GameEntity::Void)
-        actions.push_back(Action::PLAYER_A_UP);
+        mask |= 1 << actionToIndex(Action::PLAYER_A_UP);
     if (state.first[position.first][position.second + 1] != GameEntity::Void)
-        actions.push_back(Action::PLAYER_A_RIGHT);
+        mask |= 1 << actionToIndex(Action::PLAYER_A_RIGHT);
     if (state.first[position.first][position.second - 1] != GameEntity::Void)
-        actions.push_back(Action::PLAYER_A_LEFT);
+        mask |= 1 << actionToIndex(Action::PLAYER_A_LEFT);
     if (state.first[position.first + 1][position.second] != GameEntity::Void)
-        actions.push_back(Action::PLAYER_A_DOWN);
-    return actions;
+        mask |= 1 << actionToIndex(Action::PLAYER_A_DOWN);
+    return mask;
+}
+
+void Learner::record(const Transition& transition)
+{
+    if (!queue)
+    {
+        applyTransition(transition);
+        return;
+    }
+    // The actor waits for the learner thread when its queue is full, so that
+    // no transition is lost.
+    while (!queue->push(transition))
+        std::this_thread::yield();
+}
+
+void Learner::prefetchRow(int state)
+{
+    // The snapshots are node-based maps, whose nodes can't be located without
+    // reading them.
+    if (snapshot)
+        return;
+    if (sharedTable)
+        sharedTable->prefetch(state);
+    else if (policy)
+        policy->prefetch(state);
+    else
+        table.prefetch(state);
+}
+
+void Learner::recordLookup(int state, double time)
+{
+    // A state that is looked up again is still in cache from the last lookup
+    // either way, so it says nothing about the prefetches.
+    if (state == lastLookup)
+        return;
+    lastLookup = state;
+    auto end = successors.begin() + successorCount;
+    if (std::find(successors.begin(), end, state) != end)
+    {
+        ++prefetchedLookups;
+        if (time >= 0)
+        {
+            ++prefetchedSamples;
+            prefetchedLookupTime += time;
+        }
+    }
+    else
+    {
+        ++otherLookups;
+        if (time >= 0)
+        {
+            ++otherSamples;
+            otherLookupTime += time;
+        }
+    }
+}
+
+const QEntry& Learner::findEntry(int state, QEntry& buffer)
+{
+    static const QEntry empty{};
+    if (snapshot)
+    {
+        auto it = snapshot->entries.find(state);
+        return it == snapshot->entries.end() ? empty : it->second;
+    }
+    if (sharedTable)
+        return sharedTable->find(state, buffer);
+    if (policy)
+    {
+        auto utilities = policy->find(state);
+        std::copy(utilities, utilities + 4, buffer.utilities.begin());
+        return buffer;
+    }
+    return table.find(state);
+}
+
+void Learner::addUtility(int state, int actionIndex, float delta)
+{
+    if (sharedTable)
+        sharedTable->addUtility(state, actionIndex, delta);
+    else
+        table.get(state).utilities[actionIndex] += delta;
+}
+
+void Learner::addVisit(int state, int actionIndex)
+{
+    if (sharedTable)
+    {
+        sharedTable->addVisit(state, actionIndex);
+        return;
+    }
+    auto& counts = table.get(state).visited;
+    ++counts[actionIndex];
+    if (counts[actionIndex] == 1000000000)
+        --counts[actionIndex]; // Avoids overflow.
+}
+
+void Learner::getSketchCounts(int state, QEntry::VisitRow& counts)
+{
+    for (int i = 0; i < 4; ++i)
+        counts[i] = sketch->estimate(getSketchKey(state, i));
+}
+
+std::uint64_t Learner::getSketchKey(int state, int actionIndex)
+{
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(state))
+            << 2) |
+        actionIndex;
 }
 
 int Learner::actionToIndex(const Action& action)
 {
-    return action == Action::PLAYER_A_NOOP ? 0 : action - 1;
+    return action - Action::PLAYER_A_UP;
+}
+
+Action Learner::indexToAction(int index)
+{
+    return static_cast<Action>(Action::PLAYER_A_UP + index);
 }
 
 void Learner::reset()
@@ -145,6 +486,21 @@ void Learner::reset()
     randomActionCount = 0;
     totalActionCount = 0;
     isRandomAction = true;
+    table.resetStatistics();
+    sketchDecisions = 0;
+    sketchCountErrors = 0;
+    sketchDecisionChanges = 0;
+    snapshotDecisions = 0;
+    snapshotStaleness = 0;
+    successorCount = 0;
+    lastLookup = -1;
+    lookupCount = 0;
+    prefetchedLookups = 0;
+    otherLookups = 0;
+    prefetchedSamples = 0;
+    otherSamples = 0;
+    prefetchedLookupTime = 0;
+    otherLookupTime = 0;
 
     saveToFile();
 }
@@ -164,8 +520,95 @@ float Learner::getRandomFraction()
     return totalActionCount == 0 ? 0 : randomActionCount / totalActionCount;
 }
 
+std::vector<std::pair<std::string, float>> Learner::getStatistics()
+{
+    std::vector<std::pair<std::string, float>> statistics;
+    if (queue)
+    {
+        statistics = {
+            {"Queue Depth", queue->size()},
+            {"Snapshot Staleness",
+             snapshotStaleness / std::max<long>(snapshotDecisions, 1)}};
+    }
+    else if (sharedTable)
+    {
+        statistics = {
+            {"Resident States", sharedTable->size()},
+            {"Dropped Updates", sharedTable->getDroppedUpdates()}};
+    }
+    else
+    {
+        statistics = {
+            {"Cache Hit Rate", table.getCacheHitRate()},
+            {"Evictions", table.getEvictionCount()},
+            {"Resident States", table.size()}};
+    }
+    if (validateSketch)
+    {
+        float decisions = std::max<long>(sketchDecisions, 1);
+        statistics.emplace_back(
+            "Sketch Count Error Rate", sketchCountErrors / decisions);
+        statistics.emplace_back(
+            "Sketch Decision Change Rate", sketchDecisionChanges / decisions);
+    }
+    if (isPrefetchingSuccessors)
+    {
+        // The stall saved per decision is the time that the prefetched
+        // lookups save over the others, weighted by how often they happen.
+        // The times are averaged over the sampled lookups only.
+        long lookups = std::max<long>(prefetchedLookups + otherLookups, 1);
+        float prefetchedTime =
+            prefetchedLookupTime / std::max<long>(prefetchedSamples, 1);
+        float otherTime = otherLookupTime / std::max<long>(otherSamples, 1);
+        float stallSaved = prefetchedSamples == 0 || otherSamples == 0
+            ? 0
+            : (otherTime - prefetchedTime) * prefetchedLookups / lookups;
+        statistics.emplace_back(
+            "Prefetch Hit Rate",
+            static_cast<float>(prefetchedLookups) / lookups);
+        statistics.emplace_back("Prefetched Lookup (ns)", prefetchedTime);
+        statistics.emplace_back("Other Lookup (ns)", otherTime);
+        statistics.emplace_back("Stall Saved (ns)", stallSaved);
+    }
+    return statistics;
+}
+
+int Learner::compact()
+{
+    return sharedTable ? 0 : table.compact();
+}
+
+std::size_t Learner::getTableSize()
+{
+    if (sharedTable)
+        return sharedTable->size();
+    if (policy)
+        return policy->size();
+    return table.size();
+}
+
+std::size_t Learner::getTableMemoryUsage()
+{
+    if (sharedTable)
+        return sharedTable->getMemoryUsage();
+    if (policy)
+        return policy->getMemoryUsage();
+    return table.getMemoryUsage();
+}
+
 void Learner::loadFromFile()
 {
+    // The sketch is saved separately, since the visit counts in the table are
+    // not kept when it is used. A table without a matching sketch file seeds
+    // the sketch from its exact visit counts instead.
+    bool isSketchLoaded = false;
+    if (sketch)
+    {
+        std::ifstream sketchStream{
+            "params/" + name + ".param.sketch", std::ios::binary};
+        isSketchLoaded = sketchStream && sketch->load(sketchStream);
+    }
+
     std::ifstream is{"params/" + name + ".param"};
     if (!is)
         return;
@@ -175,43 +618,185 @@ void Learner::loadFromFile()
     {
         int state;
         is >> state;
-        std::array<float, 5> utility;
-        for (int j = 0; j < 5; ++j)
-            is >> utility[j];
-        utilities[state] = utility;
+        readRow(is, table.get(state).utilities);
     }
     is >> size;
+    // Without validation, the sketch replaces the exact visit counts, which
+    // would be lost the next time the table is saved.
+    if (size > 0 && sketch && !validateSketch && !discardTable)
+        throw std::runtime_error{
+            "the table " + name +
+            " has exact visit counts, which --visit_sketch would discard; "
+            "add --validate_sketch to keep them"};
     for (int i = 0; i < size; ++i)
     {
         int state;
         is >> state;
-        std::array<int, 5> counts;
-        for (int j = 0; j < 5; ++j)
-            is >> counts[j];
-        visited[state] = counts;
+        QEntry::VisitRow counts;
+        readRow(is, counts);
+        if (sketch && !isSketchLoaded)
+            for (int j = 0; j < 4; ++j)
+                if (counts[j] > 0)
+                    sketch->add(getSketchKey(state, j), counts[j]);
+        if (!sketch || validateSketch)
+            table.get(state).visited = counts;
     }
+    table.resetStatistics();
 }
 
 void Learner::saveToFile()
 {
+    // A shared table or an actor's master is saved by its owner instead.
+    if (frozen || discardTable || sharedTable || queue)
+        return;
+
+    // The utilities and visit counts are saved in separate sections, and each
+    // section skips the rows that only contain zeros. The spilled states are
+    // never in memory at the same time, so each state is saved once.
+    auto hasUtilities = [](const QEntry& entry) {
+        return std::any_of(
+            entry.utilities.begin(), entry.utilities.end(), [](float u) {
+                return u != 0;
+            });
+    };
+    auto hasVisited = [](const QEntry& entry) {
+        return std::any_of(
+            entry.visited.begin(), entry.visited.end(), [](int n) {
+                return n != 0;
+            });
+    };
+    auto writeUtilities = [](std::ostream& os, int state, const QEntry& entry) {
+        os << state << " ";
+        writeRow(os, entry.utilities);
+        os << std::endl;
+    };
+    auto writeVisited = [](std::ostream& os, int state, const QEntry& entry) {
+        os << state << " ";
+        writeRow(os, entry.visited);
+        os << std::endl;
+    };
+
+    int utilityRows = spilledUtilityRows, visitedRows = spilledVisitedRows;
+    table.forEach([&](int /*state*/, const QEntry& entry) {
+        utilityRows += hasUtilities(entry);
+        visitedRows += hasVisited(entry);
+    });
+
     std::ofstream os{"params/" + name + ".param.temp"};
-    os << utilities.size() << std::endl;
-    for (const auto& p : utilities)
+    os << utilityRows << std::endl;
+    forEachSpilled([&](int state, const QEntry& entry) {
+        if (hasUtilities(entry))
+            writeUtilities(os, state, entry);
+    });
+    table.forEach([&](int state, const QEntry& entry) {
+        if (hasUtilities(entry))
+            writeUtilities(os, state, entry);
+    });
+    os << visitedRows << std::endl;
+    forEachSpilled([&](int state, const QEntry& entry) {
+        if (hasVisited(entry))
+            writeVisited(os, state, entry);
+    });
+    table.forEach([&](int state, const QEntry& entry) {
+        if (hasVisited(entry))
+            writeVisited(os, state, entry);
+    });
+    os.close();
+    commitFile();
+
+    if (sketch)
     {
-        os << p.first << " ";
-        for (const auto& utility : p.second)
-            os << utility << " ";
-        os << std::endl;
+        std::ofstream sketchStream{
+            "params/" + name + ".param.sketch.temp", std::ios::binary};
+        sketch->save(sketchStream);
+        sketchStream.close();
+        rename(
+            ("params/" + name + ".param.sketch.temp").c_str(),
+            ("params/" + name + ".param.sketch").c_str());
     }
-    os << visited.size() << std::endl;
-    for (const auto& p : visited)
+}
+
+void Learner::saveState(std::ostream& os) const
+{
+    os << currentState << " " << lastState << " " << currentAction << " "
+       << lastAction << " " << randomActionCount << " " << totalActionCount
+       << " " << isRandomAction << std::endl;
+}
+
+void Learner::restoreState(std::istream& is)
+{
+    int current, last;
+    is >> currentState >> lastState >> current >> last >> randomActionCount >>
+        totalActionCount >> isRandomAction;
+    if (!is)
+        throw std::runtime_error{"invalid learner state for " + name};
+    currentAction = static_cast<Action>(current);
+    lastAction = static_cast<Action>(last);
+}
+
+void Learner::spillEntry(int state, const QEntry& entry)
+{
+    SpilledRow row;
+    spill.seekp(0, std::ios::end);
+    row.offset = spill.tellp();
+    spill << state << " ";
+    writeRow(spill, entry.utilities);
+    writeRow(spill, entry.visited);
+    spill << std::endl;
+    row.hasUtilities = std::any_of(
+        entry.utilities.begin(), entry.utilities.end(), [](float u) {
+            return u != 0;
+        });
+    row.hasVisited = std::any_of(
+        entry.visited.begin(), entry.visited.end(), [](int n) {
+            return n != 0;
+        });
+    spilledUtilityRows += row.hasUtilities;
+    spilledVisitedRows += row.hasVisited;
+    spilledRows[state] = row;
+}
+
+bool Learner::unspillEntry(int state, QEntry& entry)
+{
+    auto it = spilledRows.find(state);
+    if (it == spilledRows.end())
+        return false;
+    // The row stays in the file, but is no longer indexed, so that only the
+    // copy in the table is saved.
+    spill.seekg(it->second.offset);
+    int spilledState;
+    spill >> spilledState;
+    readRow(spill, entry.utilities);
+    readRow(spill, entry.visited);
+    spilledUtilityRows -= it->second.hasUtilities;
+    spilledVisitedRows -= it->second.hasVisited;
+    spilledRows.erase(it);
+    return true;
+}
+
+void Learner::forEachSpilled(
+    const std::function<void(int state, const QEntry& entry)>& f)
+{
+    if (spilledRows.empty())
+        return;
+    // The file is read in order, skipping the rows that were read back into
+    // the table or spilled again later.
+    spill.flush();
+    spill.seekg(0);
+    std::streamoff offset = spill.tellg();
+    int state;
+    while (spill >> state)
     {
-        os << p.first << " ";
-        for (const auto& count : p.second)
-            os << count << " ";
-        os << std::endl;
+        QEntry entry;
+        readRow(spill, entry.utilities);
+        readRow(spill, entry.visited);
+        auto it = spilledRows.find(state);
+        if (it != spilledRows.end() && it->second.offset == offset)
+            f(state, entry);
+        spill >> std::ws;
+        offset = spill.tellg();
     }
-    commitFile();
+    spill.clear();
 }
 
 void Learner::commitFile()
@@ -1,15 +1,28 @@
 #pragma once
 
+#include <array>
+#include <chrono>
 #include <vector>
-#include <unordered_map>
 #include <string>
 #include <utility>
+#include <memory>
+#include <unordered_map>
+#include <fstream>
+#include <iostream>
+#include <functional>
 
 #include <ale/ale_interface.hpp>
 
 #include "feature-extractor.h"
 #include "state-encoding.h"
 #include "exploration-policy.h"
+#include "learner-config.h"
+#include "q-table.h"
+#include "shared-q-table.h"
+#include "policy-artifact.h"
+#include "count-min-sketch.h"
+#include "random-engine.h"
+#include "actor-learner.h"
 
 namespace Qbert {
 
@@ -20,9 +33,45 @@ class Learner
     const StateEncoding encodeState;
     const ExplorationPolicy explore;
     const float alpha, gamma;
+    const bool frozen;
+    const bool discardTable;
+
+    QTable table;
+    std::shared_ptr<SharedQTable> sharedTable;
+    std::unique_ptr<const PolicyArtifact> policy;
+    struct SpilledRow
+    {
+        std::streamoff offset;
+        bool hasUtilities;
+        bool hasVisited;
+    };
+
+    std::fstream spill;
+    std::unordered_map<int, SpilledRow> spilledRows;
+    int spilledUtilityRows{0};
+    int spilledVisitedRows{0};
+
+    std::shared_ptr<TransitionQueue> queue;
+    const SnapshotChannel* channel{nullptr};
+    std::shared_ptr<const PolicySnapshot> snapshot;
+    long snapshotDecisions{0};
+    double snapshotStaleness{0};
+
+    std::unique_ptr<CountMinSketch> sketch;
+    const bool validateSketch;
+    RandomEngine replayEngine;
+    long sketchDecisions{0};
+    long sketchCountErrors{0};
+    long sketchDecisionChanges{0};
+    const bool isPrefetchingSuccessors;
+    std::array<int, 4> successors;
+    int successorCount{0};
+    int lastLookup{-1};
+    long lookupCount{0};
+    long prefetchedLookups{0}, otherLookups{0};
+    long prefetchedSamples{0}, otherSamples{0};
+    double prefetchedLookupTime{0}, otherLookupTime{0};
 
-    std::unordered_map<int, std::array<float, 5>> utilities;
-    std::unordered_map<int, std::array<int, 5>> visited;
     int currentState{-1}, lastState{-1};
     Action currentAction{Action::PLAYER_A_NOOP},
         lastAction{Action::PLAYER_A_NOOP};
@@ -33,30 +82,56 @@ class Learner
 
 public:
     // Constructs a learner with the given name, state encoding function,
-    // exploration policy, and learning parameters.
+    // exploration policy, and settings.
     Learner(
         std::string name,
         StateEncoding encodeState,
         ExplorationPolicy explore,
-        float alpha = 0.10f,
-        float gamma = 0.90f);
+        const LearnerConfig& config = {});
 
-    // Updates the state of the learner and assigns the given reward to the
-    // last state transition.
-    void update(
+    // Returns the encoding of the given state for this learner. A decision
+    // encodes its state once and passes the result to prefetch, getAction and
+    // update.
+    int encode(
         std::pair<int, int> position,
         const StateType& state,
-        const Action& actionPerformed,
-        float reward,
         Color startColor,
         Color goalColor,
-        int level);
+        int level) const;
+
+    // Updates the state of the learner to the given encoded state, whose valid
+    // actions are given by the mask, and assigns the given reward to the last
+    // state transition.
+    void update(
+        int encodedState,
+        int mask,
+        const Action& actionPerformed,
+        float reward);
 
     // Assigns an additional reward to the last state transition.
     void correctUpdate(float reward);
 
-    // Returns the best action to take from the point of view of this learner.
-    Action getAction(
+    // Applies the given transition to the table. This is how the updates of
+    // an actor's learner reach its master.
+    void applyTransition(const Transition& transition);
+
+    // Returns a copy of the table for the actors.
+    ParamTable createSnapshot();
+
+    // Returns the best action to take in the given encoded state, whose valid
+    // actions are given by the mask, from the point of view of this learner.
+    // Returns NOOP if there are no valid actions.
+    Action getAction(int encodedState, int mask);
+
+    // Prefetches the row that this learner reads for the given encoded state,
+    // so that the next call to getAction or update doesn't wait for memory.
+    void prefetch(int encodedState);
+
+    // Prefetches the rows of the states that each valid move from the given
+    // state leads to, assuming that nothing else moves. This should be called
+    // before the chosen move is sent to the emulator, so that the rows are in
+    // cache by the time the move is over.
+    void prefetchSuccessors(
         std::pair<int, int> position,
         const StateType& state,
         Color startColor,
@@ -73,20 +148,93 @@ public:
     float getTotalActionCount();
     float getRandomFraction();
 
-private:
-    // Returns the valid actions for the given state (the ones that don't result
-    // in guaranteed insta-death).
-    std::vector<Action>
-        getActions(std::pair<int, int> position, const StateType& state);
+    // Returns named statistics about the learner since the last reset.
+    std::vector<std::pair<std::string, float>> getStatistics();
+
+    // Removes the rows that only contain zeros from the table. These rows
+    // carry no information, since they are identical to the default row that
+    // is read for unknown states. Returns the number of rows removed.
+    int compact();
+
+    // Returns the number of rows in the table.
+    std::size_t getTableSize();
+
+    // Returns an estimate of the memory used by the tables, in bytes.
+    std::size_t getTableMemoryUsage();
+
+    // Saves the utilities to a file. A frozen learner, or one that discards
+    // its table, never saves.
+    void saveToFile();
 
-    // Maps the actions to their index in the utility arrays.
+    // Writes the state of the learner in the current game, but not its table,
+    // so that the game can be resumed later.
+    void saveState(std::ostream& os) const;
+
+    // Restores the state of the learner written by saveState.
+    void restoreState(std::istream& is);
+
+    // Returns the utilities of the actions in the given encoded state, in the
+    // order of their indices.
+    QEntry::UtilityRow getUtilities(int encodedState);
+
+    // Returns true if the last action returned by getAction was random.
+    bool wasRandomAction();
+
+    // Returns a mask of the valid actions for the given state (the ones that
+    // don't result in guaranteed insta-death). Bit i is set if the action with
+    // index i is valid.
+    static int getActionMask(
+        std::pair<int, int> position, const StateType& state);
+
+    // Maps the actions to their index in the utility rows.
     static int actionToIndex(const Action& action);
 
+    // Maps an index in the utility rows to its action.
+    static Action indexToAction(int index);
+
+private:
+    // Applies the given transition to the table, or sends it to the master
+    // for an actor's learner.
+    void record(const Transition& transition);
+
+    // Prefetches the row of the given state in the table in use.
+    void prefetchRow(int state);
+
+    // Records the lookup of the given state depending on whether the state was
+    // prefetched, along with the time that it took in nanoseconds if it was
+    // sampled, or a negative time otherwise.
+    void recordLookup(int state, double time);
+
+    // Returns the entry for the given state from the table in use, using the
+    // given buffer if needed.
+    const QEntry& findEntry(int state, QEntry& buffer);
+
+    // Adds the given delta to the utility of the given action.
+    void addUtility(int state, int actionIndex, float delta);
+
+    // Adds a visit to the given action in the table in use.
+    void addVisit(int state, int actionIndex);
+
+    // Gets the visit counts estimated by the sketch for the given state.
+    void getSketchCounts(int state, QEntry::VisitRow& counts);
+
+    // Returns the key used for the given state and action in the sketch.
+    static std::uint64_t getSketchKey(int state, int actionIndex);
+
     // Loads the utilities from a file.
     void loadFromFile();
 
-    // Saves the utilities to a file.
-    void saveToFile();
+    // Appends an evicted entry to the spill file.
+    void spillEntry(int state, const QEntry& entry);
+
+    // Reads the entry for the given state back from the spill file, if it was
+    // spilled and not read back since. Returns true if the entry was found.
+    bool unspillEntry(int state, QEntry& entry);
+
+    // Calls the given function for each entry that is still in the spill file,
+    // rather than back in the table.
+    void forEachSpilled(
+        const std::function<void(int state, const QEntry& entry)>& f);
 
     // Commits the saved file by renaming a temporary copy. This allows for
     // less chance of corruption if the program is interrupted.
@@ -0,0 +1,111 @@
+#include "level-snapshots.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "checkpoint.h"
+#include "random-engine.h"
+
+namespace Qbert {
+
+constexpr std::size_t LevelSnapshots::maxSnapshotsPerLevel;
+
+LevelSnapshots::LevelSnapshots(std::string directory) : directory{directory}
+{
+    mkdir(directory.c_str(), 0755);
+    auto dir = opendir(directory.c_str());
+    if (dir == nullptr)
+        throw std::runtime_error{"cannot open " + directory};
+    while (auto entry = readdir(dir))
+    {
+        int level;
+        char extension[16];
+        if (std::sscanf(entry->d_name, "level-%d.%15s", &level, extension) !=
+                2 ||
+            std::string{extension} != "snapshots")
+            continue;
+
+        std::ifstream is{getPath(level), std::ios::binary};
+        std::size_t count;
+        is >> count;
+        auto& levelSnapshots = snapshots[level];
+        levelSnapshots.resize(count);
+        for (auto& snapshot : levelSnapshots)
+        {
+            readString(is, snapshot.systemState);
+            readString(is, snapshot.progress);
+        }
+        if (!is)
+            throw std::runtime_error{"invalid snapshots " + getPath(level)};
+    }
+    closedir(dir);
+}
+
+void LevelSnapshots::capture(ALEInterface& ale, Agent& agent)
+{
+    LevelSnapshot snapshot;
+    snapshot.systemState = ale.cloneSystemState().serialize();
+    std::ostringstream os;
+    agent.saveProgress(os);
+    snapshot.progress = os.str();
+
+    int level = agent.getLevel();
+    auto& levelSnapshots = snapshots[level];
+    if (levelSnapshots.size() == maxSnapshotsPerLevel)
+        levelSnapshots.erase(levelSnapshots.begin());
+    levelSnapshots.push_back(snapshot);
+    save(level);
+}
+
+int LevelSnapshots::restore(ALEInterface& ale, Agent& agent) const
+{
+    int totalWeight = 0;
+    for (const auto& p : snapshots)
+        totalWeight += p.first + 1;
+    if (totalWeight == 0)
+        return -1;
+
+    int choice = getRandomInt(totalWeight);
+    for (const auto& p : snapshots)
+    {
+        choice -= p.first + 1;
+        if (choice >= 0)
+            continue;
+        const auto& levelSnapshots = p.second;
+        int index = getRandomInt(static_cast<int>(levelSnapshots.size()));
+        const auto& snapshot = levelSnapshots[index];
+        ale.restoreSystemState(ALEState{snapshot.systemState});
+        std::istringstream is{snapshot.progress};
+        agent.restoreProgress(is);
+        return p.first;
+    }
+    return -1;
+}
+
+std::string LevelSnapshots::getPath(int level) const
+{
+    return directory + "/level-" + std::to_string(level) + ".snapshots";
+}
+
+void LevelSnapshots::save(int level) const
+{
+    // The file is replaced atomically, so that an interrupted run keeps the
+    // previous snapshots.
+    auto path = getPath(level);
+    const auto& levelSnapshots = snapshots.at(level);
+    std::ofstream os{path + ".temp", std::ios::binary};
+    os << levelSnapshots.size() << std::endl;
+    for (const auto& snapshot : levelSnapshots)
+    {
+        writeString(os, snapshot.systemState);
+        writeString(os, snapshot.progress);
+    }
+    os.close();
+    rename((path + ".temp").c_str(), path.c_str());
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <ale/ale_interface.hpp>
+
+#include "agent.h"
+
+namespace Qbert {
+
+// A game saved at the start of a level.
+struct LevelSnapshot
+{
+    // The emulator state, as given by ALEInterface::cloneSystemState.
+    std::string systemState;
+
+    // The progress of the agent, as written by Agent::saveProgress.
+    std::string progress;
+};
+
+// A library of games saved at the start of each level, kept in a directory
+// with one file per level. This lets training start from the later levels
+// without playing through the earlier ones every time.
+class LevelSnapshots
+{
+    std::string directory;
+    std::map<int, std::vector<LevelSnapshot>> snapshots;
+
+public:
+    // The number of snapshots kept for each level. The oldest snapshot of a
+    // level is dropped to make room for a new one.
+    static constexpr std::size_t maxSnapshotsPerLevel = 16;
+
+    // Loads the library in the given directory, creating the directory if
+    // needed.
+    explicit LevelSnapshots(std::string directory);
+
+    // Adds a snapshot of the given game, which just started the agent's
+    // current level, and saves the level's file.
+    void capture(ALEInterface& ale, Agent& agent);
+
+    // Restores a game that was just reset to a snapshot chosen at random, with
+    // each level weighted by its number plus one, so that the later levels,
+    // which are the hardest to reach, are played the most. Returns the level
+    // of the snapshot, or -1 if the library is empty and the game starts from
+    // the beginning.
+    int restore(ALEInterface& ale, Agent& agent) const;
+
+private:
+    // Returns the path of the file for the given level.
+    std::string getPath(int level) const;
+
+    // Writes the file for the given level.
+    void save(int level) const;
+};
+}
@@ -0,0 +1,166 @@
+#include "lookahead-search.h"
+
+#include "action-selection.h"
+#include "feature-extractor.h"
+#include "learner.h"
+#include "random-engine.h"
+
+namespace Qbert {
+
+// The number of frames after which a hop is assumed to be over. This is long
+// enough for the animations of a death to end.
+static constexpr int maxHopFrames = 300;
+
+// The number of frames between two checks of the deadline during a hop.
+static constexpr int deadlineCheckFrames = 8;
+
+constexpr int LookaheadSearch::rolloutsPerMove;
+
+LookaheadSearch::LookaheadSearch(
+    ALEInterface& ale,
+    const std::string& rom,
+    int randomSeed,
+    int threads,
+    int hops,
+    std::chrono::microseconds budget)
+    : ale{ale}, hops{hops}, budget{budget}
+{
+    for (int i = 0; i < threads; ++i)
+    {
+        emulators.push_back(std::make_unique<ALEInterface>());
+        emulators.back()->setInt("random_seed", randomSeed + i);
+        emulators.back()->loadROM(rom);
+    }
+    for (int i = 0; i < threads; ++i)
+        workers.emplace_back(&LookaheadSearch::work, this, i, randomSeed + i);
+}
+
+LookaheadSearch::~LookaheadSearch()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        isStopping = true;
+    }
+    started.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+LookaheadResult LookaheadSearch::search(int mask)
+{
+    root = ale.cloneSystemState();
+    moves.clear();
+    for (int i = 0; i < countActions(mask); ++i)
+        moves.push_back(getNthAction(mask, i));
+    result = LookaheadResult{};
+    taskCount = rolloutsPerMove * static_cast<int>(moves.size());
+    nextTask = 0;
+    deadline = std::chrono::steady_clock::now() + budget;
+
+    std::unique_lock<std::mutex> lock{mutex};
+    ++generation;
+    activeWorkers = static_cast<int>(workers.size());
+    started.notify_all();
+    finished.wait(lock, [&]() { return activeWorkers == 0; });
+
+    for (int i = 0; i < 4; ++i)
+    {
+        if (result.rollouts[i] == 0)
+            continue;
+        result.values[i] /= result.rollouts[i];
+        result.deathRates[i] /= result.rollouts[i];
+    }
+    return result;
+}
+
+void LookaheadSearch::work(int worker, int randomSeed)
+{
+    seedRandomEngine(randomSeed);
+    auto& emulator = *emulators[worker];
+    int lastGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            started.wait(lock, [&]() {
+                return isStopping || generation != lastGeneration;
+            });
+            if (isStopping)
+                return;
+            lastGeneration = generation;
+        }
+
+        // The tasks go through the moves in turn, so that each move has some
+        // rollouts even if the budget runs out.
+        for (int task = nextTask++; task < taskCount; task = nextTask++)
+        {
+            int move = moves[task % moves.size()];
+            float value;
+            bool isDeath;
+            if (!rollout(emulator, move, value, isDeath))
+                break;
+            std::lock_guard<std::mutex> lock{mutex};
+            result.values[move] += value;
+            result.deathRates[move] += isDeath;
+            ++result.rollouts[move];
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+        if (--activeWorkers == 0)
+            finished.notify_all();
+    }
+}
+
+bool LookaheadSearch::rollout(
+    ALEInterface& emulator, int move, float& value, bool& isDeath)
+{
+    emulator.restoreSystemState(root);
+    int lives = emulator.lives();
+    auto action = Learner::indexToAction(move);
+    value = 0;
+    isDeath = false;
+    for (int hop = 0; hop < hops; ++hop)
+    {
+        int frames = 0;
+        bool isJumping = false;
+        while (frames < maxHopFrames && !emulator.game_over() &&
+               emulator.lives() == lives)
+        {
+            if (frames % deadlineCheckFrames == 0 &&
+                std::chrono::steady_clock::now() >= deadline)
+                return false;
+            value += emulator.act(action);
+            ++frames;
+            // The hop is over once the game accepts an action again after the
+            // jump has started.
+            if (!isAcceptingAction(emulator))
+                isJumping = true;
+            else if (isJumping)
+                break;
+        }
+        if (emulator.game_over() || emulator.lives() < lives)
+        {
+            value -= 1000;
+            isDeath = true;
+            return true;
+        }
+
+        // Qbert is not on the pyramid while riding a disc, and waits for it.
+        auto state = getState(emulator);
+        action = Action::PLAYER_A_NOOP;
+        for (int x = 0; x < 8; ++x)
+        {
+            for (int y = 0; y < 8; ++y)
+            {
+                if (state.first[x][y] != GameEntity::Qbert)
+                    continue;
+                int mask = Learner::getActionMask({x, y}, state);
+                if (mask != 0)
+                    action = Learner::indexToAction(
+                        getNthAction(mask, getRandomInt(countActions(mask))));
+            }
+        }
+    }
+    return true;
+}
+}
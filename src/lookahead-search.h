@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ale/ale_interface.hpp>
+
+namespace Qbert {
+
+// The outcomes of the rollouts of each move, in the order of the action
+// indices of the learners.
+struct LookaheadResult
+{
+    // The mean return of the rollouts, counting a death as -1000, as the
+    // agents do.
+    std::array<float, 4> values{};
+
+    // The fraction of the rollouts that ended in a death.
+    std::array<float, 4> deathRates{};
+
+    // The number of rollouts that finished within the budget.
+    std::array<int, 4> rollouts{};
+};
+
+// A short-horizon search that rolls out each valid move from the current
+// state of a game for a few hops. The rollouts are spread over worker threads,
+// each of which plays a copy of the game in its own emulator. The first hop of
+// a rollout plays the move, and the following hops play random valid moves.
+class LookaheadSearch
+{
+    ALEInterface& ale;
+    const int hops;
+    const std::chrono::microseconds budget;
+
+    std::vector<std::unique_ptr<ALEInterface>> emulators;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable started, finished;
+    bool isStopping{false};
+    int generation{0};
+    int activeWorkers{0};
+
+    ALEState root;
+    std::vector<int> moves;
+    int taskCount{0};
+    std::atomic<int> nextTask{0};
+    std::chrono::steady_clock::time_point deadline;
+    LookaheadResult result;
+
+public:
+    // The number of rollouts of each move.
+    static constexpr int rolloutsPerMove = 4;
+
+    // Constructs a search of the given number of hops from the game in the
+    // given emulator, using the given number of worker threads, each of which
+    // loads the given ROM. A search stops starting rollouts once the given
+    // budget has passed, and abandons the ones in progress.
+    LookaheadSearch(
+        ALEInterface& ale,
+        const std::string& rom,
+        int randomSeed,
+        int threads,
+        int hops,
+        std::chrono::microseconds budget);
+
+    ~LookaheadSearch();
+
+    // Rolls out the moves in the given mask of valid actions from the current
+    // state of the game.
+    LookaheadResult search(int mask);
+
+private:
+    // Runs the rollouts of each search in the given worker's emulator.
+    void work(int worker, int randomSeed);
+
+    // Plays a rollout of the given move in the given emulator, and returns
+    // its return and whether it ended in a death. Returns false if the
+    // rollout ran out of time.
+    bool rollout(
+        ALEInterface& emulator, int move, float& value, bool& isDeath);
+};
+}
@@ -1,21 +1,68 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
 #include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#include <unistd.h>
 
 #include <ale/ale_interface.hpp>
 
+#include "agent-factory.h"
 #include "args.h"
+#include "benchmark.h"
+#include "checkpoint.h"
+#include "evaluation.h"
+#include "exploration-archive.h"
 #include "feature-extractor.h"
+#include "fork-server.h"
 #include "game-entity.h"
-#include "monolithic-agent.h"
-#include "subsumption-agent-2.h"
+#include "learner.h"
+#include "level-snapshots.h"
+#include "param-file.h"
+#include "param-merge.h"
+#include "parallel-training.h"
+#include "policy-artifact.h"
+#include "random-engine.h"
+#include "shard-coordinator.h"
 #include "state-encoding.h"
+#include "sweep.h"
 
 using namespace Qbert;
 
 void learn(const Args& args);
-std::unique_ptr<Agent> createAgent(ALEInterface& ale, const Args& args);
+void writeResultsHeader(std::ostream& os, Agent& agent);
+TrainingThroughput playEpisodes(
+    const Args& args,
+    ALEInterface& ale,
+    Agent& agent,
+    std::ofstream& os,
+    int episode,
+    const std::string& checkpointPath,
+    LevelSnapshots* snapshots,
+    ExplorationArchive* archive);
+void runForkJob(
+    const Args& args,
+    ALEInterface& ale,
+    Agent& agent,
+    const std::string& results);
+void saveCheckpoint(
+    const std::string& path,
+    int episode,
+    std::ofstream& results,
+    ALEInterface* ale,
+    const Agent& agent);
+void learnInParallel(const Args& args);
+void printThroughput(const TrainingThroughput& throughput);
+void measureScaling(const Args& args);
+void compact(const Args& args);
+void exportPolicies(const Args& args);
+void merge(const Args& args);
 void print(const StateType& state);
 
 int main(int argc, char** argv)
@@ -25,8 +72,32 @@ int main(int argc, char** argv)
         auto args = parseArgs(argc, argv);
         if (args.help)
             printUsage(argv[0]);
-        else
+        else if (args.mode == "learn")
             learn(args);
+        else if (args.mode == "coordinator")
+            coordinate(args, learn);
+        else if (args.mode == "fork_server")
+            serveForks(args, runForkJob);
+        else if (args.mode == "scaling")
+            measureScaling(args);
+        else if (args.mode == "compact")
+            compact(args);
+        else if (args.mode == "benchmark")
+            benchmark(args);
+        else if (args.mode == "export")
+            exportPolicies(args);
+        else if (args.mode == "evaluate")
+            evaluate(args);
+        else if (args.mode == "compare")
+            compare(args);
+        else if (args.mode == "sweep")
+            sweep(args, learn);
+        else if (args.mode == "pbt")
+            trainPopulation(args, learn);
+        else if (args.mode == "merge")
+            merge(args);
+        else
+            throw ArgsError{"invalid mode"};
         return 0;
     }
     catch (ArgsError& e)
@@ -48,6 +119,15 @@ int main(int argc, char** argv)
 
 void learn(const Args& args)
 {
+    if (args.threads > 1 || args.envs > 1 || args.actorLearner ||
+        !args.tableDirectory.empty())
+    {
+        learnInParallel(args);
+        return;
+    }
+
+    seedRandomEngine(args.randomSeed);
+
     ALEInterface ale;
     ale.setInt("random_seed", args.randomSeed);
     ale.setBool("display_screen", args.displayScreen);
@@ -57,65 +137,389 @@ void learn(const Args& args)
 
     auto agent = createAgent(ale, args);
 
-    std::ofstream os{"results/scores." + args.learner + "." +
-                     args.explorationPolicy.first + ".csv"};
-    os << "Episode,Score,Random" << std::endl;
-    int episode = 0;
-    while (true)
+    // Evaluation, curriculum and exploration runs have their own results, so
+    // that they don't overwrite the ones from training from the start of the
+    // game.
+    std::string prefix{"scores"};
+    if (args.learnerConfig.frozen)
+        prefix = "eval";
+    else if (args.curriculum)
+        prefix = "curriculum";
+    else if (args.exploreArchive)
+        prefix = "explore";
+    auto results = "results/" + prefix + "." + args.learner + "." +
+        args.explorationPolicy.first;
+    auto checkpointPath = results + ".checkpoint";
+
+    std::unique_ptr<LevelSnapshots> snapshots;
+    if (!args.snapshotDirectory.empty())
+        snapshots = std::make_unique<LevelSnapshots>(args.snapshotDirectory);
+    std::unique_ptr<ExplorationArchive> archive;
+    if (args.exploreArchive)
+        archive = std::make_unique<ExplorationArchive>(results + ".archive");
+
+    Checkpoint checkpoint;
+    std::ofstream os;
+    if (args.resume && readCheckpoint(checkpointPath, checkpoint))
+    {
+        // We drop the results written after the checkpoint, since those
+        // episodes are played again.
+        auto resultsFile = results + ".csv";
+        if (truncate(resultsFile.c_str(), checkpoint.resultsOffset) != 0)
+            throw std::runtime_error{"cannot truncate " + results + ".csv"};
+        os.open(results + ".csv", std::ios::app);
+        loadRandomEngine(checkpoint.randomState);
+        if (archive)
+            archive->load();
+        if (!checkpoint.systemState.empty())
+        {
+            ale.restoreSystemState(ALEState{checkpoint.systemState});
+            std::istringstream is{checkpoint.agentState};
+            agent->restoreState(is);
+        }
+        std::cout << "Resuming at episode " << checkpoint.episode + 1 << "."
+                  << std::endl;
+    }
+    else
+    {
+        os.open(results + ".csv");
+        writeResultsHeader(os, *agent);
+    }
+
+    // A game resumed in the middle is already past its start.
+    if (args.curriculum && checkpoint.systemState.empty())
+        snapshots->restore(ale, *agent);
+    else if (archive && checkpoint.systemState.empty())
+        archive->restore(ale, *agent);
+    auto throughput = playEpisodes(
+        args,
+        ale,
+        *agent,
+        os,
+        checkpoint.episode,
+        checkpointPath,
+        snapshots.get(),
+        archive.get());
+    printThroughput(throughput);
+    // The archive is saved with the tables, so that a resumed run returns to
+    // the same cells.
+    if (archive)
+        archive->save();
+    if (archive && throughput.frames > 0)
+    {
+        std::cout << "Archive Cells: " << archive->size() << std::endl;
+        std::cout << "New Cells per 1000 Frames: "
+                  << 1000.0 * archive->getDiscoveries() / throughput.frames
+                  << std::endl;
+    }
+}
+
+void writeResultsHeader(std::ostream& os, Agent& agent)
+{
+    os << "Episode,Score,Random,Frames,Decisions,Seconds,Frames/s";
+    for (const auto& statistic : agent.getStatistics())
+        os << "," << statistic.first;
+    os << std::endl;
+}
+
+// Plays the episodes that follow the given one until one of the limits in the
+// arguments is reached, writing their results to the given stream. A run
+// without a checkpoint path writes no checkpoints. With snapshots, the start of
+// every level is captured, and with args.curriculum, every new game starts
+// from one of them. With an archive, the cells reached are added to it, and
+// every new game returns to one of them.
+TrainingThroughput playEpisodes(
+    const Args& args,
+    ALEInterface& ale,
+    Agent& agent,
+    std::ofstream& os,
+    int episode,
+    const std::string& checkpointPath,
+    LevelSnapshots* snapshots,
+    ExplorationArchive* archive)
+{
+    // The limits apply to this run, not to the ones that it resumes.
+    TrainingThroughput throughput;
+    throughput.threads = 1;
+    auto start = std::chrono::steady_clock::now();
+    auto getSeconds = [](std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - since)
+            .count();
+    };
+    auto isOutOfTime = [&]() {
+        return (args.frames > 0 && throughput.frames >= args.frames) ||
+            (args.timeLimit > 0 && getSeconds(start) >= args.timeLimit);
+    };
+
+    // A game that returns to the archive ends at its first death, since the
+    // archive already holds the cells that led up to it.
+    int episodeLives = 0;
+    auto isEpisodeOver = [&]() {
+        return ale.game_over() || (archive && ale.lives() < episodeLives);
+    };
+
+    bool isCheckpointing = !checkpointPath.empty();
+    int framesSinceCheckpoint = 0;
+    bool isStopped = false;
+    while (!isStopped)
     {
         ++episode;
-        while (!ale.game_over())
+        auto episodeStart = std::chrono::steady_clock::now();
+        episodeLives = ale.lives();
+        while (!isEpisodeOver() && !isStopped)
         {
             if (args.debug && ale.getEpisodeFrameNumber() % 20 == 0)
             {
                 auto state = getState(ale);
-                std::cout << "High Score: " << agent->getHighScore()
+                std::cout << "High Score: " << agent.getHighScore()
                           << std::endl;
                 print(state);
             }
-            agent->updateState();
+            int frames = agent.updateState();
+            if (snapshots && agent.hasLevelStarted())
+                snapshots->capture(ale, agent);
+            if (archive && agent.hasDecided() && !isEpisodeOver())
+                archive->update(ale, agent);
+
+            framesSinceCheckpoint += frames;
+            if (isCheckpointing && args.checkpointInterval > 0 &&
+                framesSinceCheckpoint >= args.checkpointInterval)
+            {
+                agent.saveTables();
+                if (archive)
+                    archive->save();
+                saveCheckpoint(checkpointPath, episode - 1, os, &ale, agent);
+                framesSinceCheckpoint = 0;
+            }
+
+            throughput.frames += frames;
+            isStopped = isOutOfTime();
         }
-        os << episode << "," << agent->getScore() << ","
-           << agent->getRandomFraction() << std::endl;
+        throughput.decisions += agent.getDecisionCount();
+        throughput.emulatorSeconds += agent.getEmulatorSeconds();
+
+        // A run that stops in the middle of an episode saves the game in
+        // progress, so that it can be resumed.
+        if (!isEpisodeOver())
+        {
+            if (isCheckpointing)
+            {
+                agent.saveTables();
+                if (archive)
+                    archive->save();
+                saveCheckpoint(checkpointPath, episode - 1, os, &ale, agent);
+            }
+            break;
+        }
+
+        double seconds = getSeconds(episodeStart);
+        os << episode << "," << agent.getScore() << ","
+           << agent.getRandomFraction() << "," << agent.getFrameCount()
+           << "," << agent.getDecisionCount() << "," << seconds << ","
+           << agent.getFrameCount() / seconds;
+        for (const auto& statistic : agent.getStatistics())
+            os << "," << statistic.second;
+        os << std::endl;
         ale.reset_game();
-        agent->resetGame();
+        agent.resetGame();
+        if (args.curriculum)
+            snapshots->restore(ale, agent);
+        else if (archive)
+            archive->restore(ale, agent);
+        if (isCheckpointing)
+            saveCheckpoint(checkpointPath, episode, os, nullptr, agent);
+
+        ++throughput.episodes;
+        if (args.episodes > 0 && throughput.episodes == args.episodes)
+            isStopped = true;
     }
+    throughput.seconds = getSeconds(start);
+    return throughput;
 }
 
-std::unique_ptr<Agent> createAgent(ALEInterface& ale, const Args& args)
+// Plays a job of the fork server with the agent and game inherited from the
+// server, and writes its results to the given file.
+void runForkJob(
+    const Args& args,
+    ALEInterface& ale,
+    Agent& agent,
+    const std::string& results)
 {
-    if (args.learner == "monolithic")
-        return std::make_unique<MonolithicAgent>(
-            ale,
-            args.learner + "-" + args.explorationPolicy.first,
-            encodeState,
-            args.explorationPolicy.second);
-    else if (args.learner == "subsumption-v1")
-        return std::make_unique<SubsumptionAgent2>(
-            ale,
-            args.learner + "-" + args.explorationPolicy.first,
-            encodeBlockState,
-            encodeEnemyState,
-            hasEnemiesNearby,
-            args.explorationPolicy.second);
-    else if (args.learner == "subsumption-v2")
-        return std::make_unique<SubsumptionAgent2>(
-            ale,
-            args.learner + "-" + args.explorationPolicy.first,
-            encodeBlockState,
-            encodeEnemyStateWithSeparateCoily,
-            hasEnemiesNearbyWithSeparateCoily,
-            args.explorationPolicy.second);
-    else if (args.learner == "subsumption-v3")
-        return std::make_unique<SubsumptionAgent2>(
-            ale,
-            args.learner + "-" + args.explorationPolicy.first,
-            encodeBlockState,
-            encodeEnemyStateWithSeparateCoilyV2,
-            hasEnemiesNearbyWithSeparateCoilyV2,
-            args.explorationPolicy.second);
-    else
-        throw ArgsError{"invalid learner"};
+    std::ofstream os{results};
+    if (!os)
+        throw std::runtime_error{"cannot open " + results};
+    writeResultsHeader(os, agent);
+    auto throughput =
+        playEpisodes(args, ale, agent, os, 0, "", nullptr, nullptr);
+    std::cout << "Wrote " << throughput.episodes << " episodes ("
+              << throughput.frames << " frames in " << throughput.seconds
+              << " s) to " << results << "." << std::endl;
+}
+
+void saveCheckpoint(
+    const std::string& path,
+    int episode,
+    std::ofstream& results,
+    ALEInterface* ale,
+    const Agent& agent)
+{
+    Checkpoint checkpoint;
+    checkpoint.episode = episode;
+    results.flush();
+    checkpoint.resultsOffset = results.tellp();
+    checkpoint.randomState = saveRandomEngine();
+    if (ale)
+    {
+        checkpoint.systemState = ale->cloneSystemState().serialize();
+        std::ostringstream os;
+        agent.saveState(os);
+        checkpoint.agentState = os.str();
+    }
+    writeCheckpoint(path, checkpoint);
+}
+
+void learnInParallel(const Args& args)
+{
+    // The processes that share tables write their own results, which are told
+    // apart by their seeds.
+    std::string prefix{args.learnerConfig.frozen ? "eval" : "scores"};
+    auto results = "results/" + prefix + "." + args.learner + "." +
+        args.explorationPolicy.first;
+    if (!args.tableDirectory.empty())
+        results += ".seed" + std::to_string(args.randomSeed);
+    std::ofstream os{results + ".csv"};
+    printThroughput(trainInParallel(args, args.timeLimit, &os));
+}
+
+void printThroughput(const TrainingThroughput& throughput)
+{
+    // The emulator time is summed over the threads, so the agent's overhead is
+    // what remains of the time that all the threads ran for.
+    double threadSeconds = throughput.seconds * throughput.threads;
+    double agentSeconds = threadSeconds - throughput.emulatorSeconds;
+    std::cout << "Episodes: " << throughput.episodes << std::endl;
+    std::cout << "Frames: " << throughput.frames << std::endl;
+    std::cout << "Decisions: " << throughput.decisions << std::endl;
+    std::cout << "Seconds: " << throughput.seconds << std::endl;
+    if (throughput.frames == 0)
+        return;
+    std::cout << "Frames/s: " << throughput.frames / throughput.seconds
+              << std::endl;
+    std::cout << "Decisions/s: " << throughput.decisions / throughput.seconds
+              << std::endl;
+    std::cout << "Emulator Frames/s (per thread): "
+              << throughput.frames / throughput.emulatorSeconds << std::endl;
+    std::cout << "Agent Overhead: " << agentSeconds / throughput.frames * 1e6
+              << " us/frame (" << 100 * agentSeconds / threadSeconds
+              << "% of the time)" << std::endl;
+}
+
+void measureScaling(const Args& args)
+{
+    // Each measurement trains the tables, so that the threads contend for them
+    // in the same way as in a real run, but never saves them, so that the
+    // measurements start from the same tables and leave the param files as
+    // they were.
+    constexpr double seconds = 30;
+    int cores = std::max<int>(std::thread::hardware_concurrency(), 1);
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < cores; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(cores);
+
+    std::cout << "Threads,Frames,Episodes,Seconds,Frames/s,Speedup,"
+                 "Transitions,Average Queue Depth,Max Queue Depth"
+              << std::endl;
+    double baseline = 0;
+    for (int threads : threadCounts)
+    {
+        auto threadArgs = args;
+        threadArgs.threads = threads;
+        threadArgs.learnerConfig.discardTable = true;
+        auto throughput = trainInParallel(threadArgs, seconds, nullptr);
+        double framesPerSecond = throughput.frames / throughput.seconds;
+        if (baseline == 0)
+            baseline = framesPerSecond;
+        std::cout << threads << "," << throughput.frames << ","
+                  << throughput.episodes << "," << throughput.seconds << ","
+                  << framesPerSecond << "," << framesPerSecond / baseline
+                  << "," << throughput.transitions << ","
+                  << throughput.averageQueueDepth << ","
+                  << throughput.maxQueueDepth << std::endl;
+    }
+}
+
+void compact(const Args& /*args*/)
+{
+    // We list the tables first, since compacting them rewrites the directory.
+    auto names = listParamFiles();
+
+    std::cout << "Table,Rows Before,Rows After,Memory Before,Memory After,"
+                 "File Before,File After"
+              << std::endl;
+    long totalMemory[2]{0, 0}, totalFile[2]{0, 0};
+    for (const auto& name : names)
+    {
+        // The state encoding and exploration policy are irrelevant here, since
+        // we never play with this learner.
+        Learner learner{name, encodeState, ExploreThreshold{0}};
+        long rowsBefore = learner.getTableSize();
+        long memoryBefore = learner.getTableMemoryUsage();
+        long fileBefore = getParamFileSize(name);
+        learner.compact();
+        learner.saveToFile();
+        long rowsAfter = learner.getTableSize();
+        long memoryAfter = learner.getTableMemoryUsage();
+        long fileAfter = getParamFileSize(name);
+        std::cout << name << "," << rowsBefore << "," << rowsAfter << ","
+                  << memoryBefore << "," << memoryAfter << "," << fileBefore
+                  << "," << fileAfter << std::endl;
+        totalMemory[0] += memoryBefore;
+        totalMemory[1] += memoryAfter;
+        totalFile[0] += fileBefore;
+        totalFile[1] += fileAfter;
+    }
+    std::cout << "Total,,," << totalMemory[0] << "," << totalMemory[1] << ","
+              << totalFile[0] << "," << totalFile[1] << std::endl;
+}
+
+void exportPolicies(const Args& /*args*/)
+{
+    std::cout << "Table,States,Param File,Live Memory,Artifact,"
+                 "Live Lookup (ns),Artifact Lookup (ns)"
+              << std::endl;
+    for (const auto& name : listParamFiles())
+    {
+        auto table = readParamFile(name);
+        auto path = PolicyArtifact::getPath(name);
+        PolicyArtifact::write(path, table);
+        PolicyArtifact artifact{path};
+
+        Learner learner{name, encodeState, ExploreThreshold{0}};
+        auto latencies = comparePolicyLookups(table, artifact);
+        std::cout << name << "," << artifact.size() << ","
+                  << getParamFileSize(name) << ","
+                  << learner.getTableMemoryUsage() << ","
+                  << artifact.getMemoryUsage() << "," << latencies.first << ","
+                  << latencies.second << std::endl;
+    }
+}
+
+void merge(const Args& args)
+{
+    if (args.inputs.empty())
+        throw ArgsError{"missing input file"};
+    if (args.output.empty())
+        throw ArgsError{"missing output file"};
+    for (const auto& input : args.inputs)
+    {
+        if (!std::ifstream{input})
+            throw std::runtime_error{"cannot open param file " + input};
+    }
+    mergeParamFiles(args.inputs, args.output);
+    std::cout << "Merged " << args.inputs.size() << " param files into "
+              << args.output << "." << std::endl;
 }
 
 void print(const StateType& state)
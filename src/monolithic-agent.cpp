@@ -6,8 +6,9 @@ MonolithicAgent::MonolithicAgent(
     ALEInterface& ale,
     const std::string& name,
     StateEncoding encodeState,
-    ExplorationPolicy explore)
-    : Agent{ale}, learner{name + "-learner", encodeState, explore}
+    ExplorationPolicy explore,
+    const LearnerConfig& config)
+    : Agent{ale}, learner{name + "-learner", encodeState, explore, config}
 {
 }
 
@@ -24,17 +25,43 @@ float MonolithicAgent::getRandomFraction()
     return totalActionCount == 0 ? 0 : randomActionCount / totalActionCount;
 }
 
-void MonolithicAgent::update(
+std::vector<std::pair<std::string, float>> MonolithicAgent::getStatistics()
+{
+    return learner.getStatistics();
+}
+
+void MonolithicAgent::saveTables()
+{
+    learner.saveToFile();
+}
+
+void MonolithicAgent::saveState(std::ostream& os) const
+{
+    Agent::saveState(os);
+    learner.saveState(os);
+}
+
+void MonolithicAgent::restoreState(std::istream& is)
+{
+    Agent::restoreState(is);
+    learner.restoreState(is);
+}
+
+void MonolithicAgent::encode(
     std::pair<int, int> position,
     const StateType& state,
-    const Action& actionPerformed,
-    float reward,
     Color startColor,
     Color goalColor,
     int level)
 {
-    learner.update(
-        position, state, actionPerformed, reward, startColor, goalColor, level);
+    encodedState =
+        learner.encode(position, state, startColor, goalColor, level);
+    mask = Learner::getActionMask(position, state);
+}
+
+void MonolithicAgent::update(const Action& actionPerformed, float reward)
+{
+    learner.update(encodedState, mask, actionPerformed, reward);
     learner.notifyActionTaken();
 }
 
@@ -43,13 +70,23 @@ void MonolithicAgent::correctUpdate(float reward)
     learner.correctUpdate(reward);
 }
 
-Action MonolithicAgent::getAction(
+Action MonolithicAgent::getAction()
+{
+    return learner.getAction(encodedState, mask);
+}
+
+void MonolithicAgent::prefetchRows()
+{
+    learner.prefetch(encodedState);
+}
+
+void MonolithicAgent::prefetchSuccessors(
     std::pair<int, int> position,
     const StateType& state,
     Color startColor,
     Color goalColor,
     int level)
 {
-    return learner.getAction(position, state, startColor, goalColor, level);
+    learner.prefetchSuccessors(position, state, startColor, goalColor, level);
 }
 }
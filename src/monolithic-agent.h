@@ -6,6 +6,7 @@
 #include "learner.h"
 #include "state-encoding.h"
 #include "exploration-policy.h"
+#include "learner-config.h"
 
 namespace Qbert {
 
@@ -13,16 +14,19 @@ namespace Qbert {
 class MonolithicAgent : public Agent
 {
     Learner learner;
+    int encodedState{-1};
+    int mask{0};
 
 public:
     // Contructs an agent with a reference to the current ALE instance, the
-    // given name, the given state encoding function, and the given
-    // exploration policy.
+    // given name, the given state encoding function, the given exploration
+    // policy, and the given table settings.
     MonolithicAgent(
         ALEInterface& ale,
         const std::string& name,
         StateEncoding encodeState,
-        ExplorationPolicy explore);
+        ExplorationPolicy explore,
+        const LearnerConfig& config);
 
     virtual ~MonolithicAgent() = default;
 
@@ -32,22 +36,46 @@ public:
     // Returns the fraction of random actions taken.
     virtual float getRandomFraction() override;
 
+    // Returns named statistics about the learners for the current game.
+    virtual std::vector<std::pair<std::string, float>> getStatistics()
+        override;
+
+    // Saves the learners' tables without ending the game.
+    virtual void saveTables() override;
+
+    // Writes the state of the current game, apart from the emulator and the
+    // tables, so that the game can be resumed later.
+    virtual void saveState(std::ostream& os) const override;
+
+    // Restores the state of the current game written by saveState.
+    virtual void restoreState(std::istream& is) override;
+
 private:
-    // Assigns the given reward to the learners.
-    virtual void update(
+    // Encodes the given state for the learners. This is done once per
+    // decision, and the other steps of the decision use the encoded states.
+    virtual void encode(
         std::pair<int, int> position,
         const StateType& state,
-        const Action& actionPerformed,
-        float reward,
         Color startColor,
         Color goalColor,
         int level) override;
 
+    // Moves the learners to the encoded state and assigns the given reward to
+    // their last state transition.
+    virtual void update(const Action& actionPerformed, float reward) override;
+
     // Assigns an additional reward to the learners without updating the state.
     virtual void correctUpdate(float reward) override;
 
-    // Gets the best action from the learners.
-    virtual Action getAction(
+    // Gets the best action in the encoded state from the learners.
+    virtual Action getAction() override;
+
+    // Prefetches the rows that the learners read for the encoded state.
+    virtual void prefetchRows() override;
+
+    // Prefetches the rows of the states that the moves from the given state
+    // lead to, for the learners that do so.
+    virtual void prefetchSuccessors(
         std::pair<int, int> position,
         const StateType& state,
         Color startColor,
@@ -0,0 +1,239 @@
+#include "parallel-training.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <ale/ale_interface.hpp>
+
+#include "actor-learner.h"
+#include "agent-factory.h"
+#include "random-engine.h"
+#include "shared-q-table.h"
+
+namespace Qbert {
+
+// The number of transitions that each actor can queue before it has to wait
+// for the learner thread.
+static constexpr std::size_t queueCapacity = 4096;
+
+// The interval between the throughput reports of an open-ended run.
+static constexpr int reportSeconds = 10;
+
+// A frame counter padded to a cache line, so that the threads don't slow each
+// other down by counting.
+struct FrameCounter
+{
+    std::atomic<long> frames{0};
+    char padding[64 - sizeof(std::atomic<long>)];
+};
+
+TrainingThroughput
+    trainInParallel(const Args& args, double seconds, std::ostream* results)
+{
+    // With a table directory, the tables belong to a coordinator process.
+    SharedTables tables{
+        args.learnerConfig,
+        args.tableDirectory,
+        args.tableDirectory.empty()};
+    ActorLearnerHub hub{queueCapacity, args.snapshotInterval};
+    bool isSaving =
+        !args.learnerConfig.frozen && !args.learnerConfig.discardTable;
+    auto threadArgs = args;
+    if (args.actorLearner)
+        threadArgs.learnerConfig.actorLearnerHub = &hub;
+    else
+        threadArgs.learnerConfig.sharedTables = &tables;
+
+    // The games and agents are created up front, since creating the agents
+    // may merge and load tables.
+    int games = args.threads * args.envs;
+    std::vector<std::unique_ptr<ALEInterface>> ales;
+    std::vector<std::unique_ptr<Agent>> agents;
+    for (int i = 0; i < games; ++i)
+    {
+        ales.push_back(std::make_unique<ALEInterface>());
+        auto& ale = *ales.back();
+        ale.setInt("random_seed", args.randomSeed + i);
+        ale.setBool("display_screen", args.displayScreen && i == 0);
+        ale.setBool("sound", args.displayScreen && i == 0);
+        ale.loadROM(args.rom);
+        agents.push_back(createAgent(ale, threadArgs));
+    }
+
+    if (results)
+    {
+        *results << "Episode,Score,Random,Frames,Decisions,Seconds,Frames/s";
+        for (const auto& statistic : agents[0]->getStatistics())
+            *results << "," << statistic.first;
+        *results << std::endl;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto getSeconds = [&](std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - since)
+            .count();
+    };
+
+    std::atomic<bool> stop{false};
+    std::atomic<bool> isSaveRequested{false};
+    std::vector<FrameCounter> counters(args.threads);
+    auto getFrames = [&]() {
+        long total = 0;
+        for (const auto& counter : counters)
+            total += counter.frames.load(std::memory_order_relaxed);
+        return total;
+    };
+
+    // The totals of the finished episodes. The games in progress are added at
+    // the end of the run.
+    std::mutex mutex;
+    int episode = 0;
+    long decisions = 0;
+    double emulatorSeconds = 0;
+    std::vector<std::chrono::steady_clock::time_point> episodeStarts(
+        games, start);
+    auto finishEpisode = [&](int game) {
+        auto& ale = *ales[game];
+        auto& agent = *agents[game];
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            // The episodes that finish once the run is over are dropped, so
+            // that a run with --episodes writes exactly that many.
+            if (args.episodes > 0 && episode == args.episodes)
+                return;
+            ++episode;
+            decisions += agent.getDecisionCount();
+            emulatorSeconds += agent.getEmulatorSeconds();
+            if (results)
+            {
+                double seconds = getSeconds(episodeStarts[game]);
+                *results << episode << "," << agent.getScore() << ","
+                         << agent.getRandomFraction() << ","
+                         << agent.getFrameCount() << ","
+                         << agent.getDecisionCount() << "," << seconds << ","
+                         << agent.getFrameCount() / seconds;
+                for (const auto& statistic : agent.getStatistics())
+                    *results << "," << statistic.second;
+                *results << std::endl;
+            }
+            if (episode == args.episodes)
+                stop = true;
+            // Only the learner thread can read the masters' tables safely, so
+            // it saves them in the actor-learner architecture.
+            if (episode % games == 0 && isSaving)
+            {
+                if (args.actorLearner)
+                    isSaveRequested = true;
+                else
+                    tables.save();
+            }
+        }
+        ale.reset_game();
+        agent.resetGame();
+        episodeStarts[game] = std::chrono::steady_clock::now();
+    };
+    auto play = [&](int i) {
+        seedRandomEngine(args.randomSeed + i);
+        std::vector<Agent*> threadAgents;
+        for (int j = i * args.envs; j < (i + 1) * args.envs; ++j)
+            threadAgents.push_back(agents[j].get());
+        auto& frames = counters[i].frames;
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            // The games of a thread advance in lockstep, and a game that ends
+            // starts over before the next step.
+            int played = updateStates(threadAgents);
+            // Each counter has a single writer, so it needs no atomic
+            // increment.
+            frames.store(
+                frames.load(std::memory_order_relaxed) + played,
+                std::memory_order_relaxed);
+            if (args.frames > 0 && getFrames() >= args.frames)
+                stop = true;
+            for (int j = i * args.envs; j < (i + 1) * args.envs; ++j)
+            {
+                if (ales[j]->game_over())
+                    finishEpisode(j);
+            }
+        }
+    };
+
+    std::atomic<bool> stopLearner{false};
+    long transitions = 0;
+    auto learn = [&]() {
+        while (!stopLearner.load(std::memory_order_relaxed))
+        {
+            long applied = hub.drain();
+            transitions += applied;
+            if (isSaveRequested.exchange(false))
+                hub.save();
+            if (applied == 0)
+                std::this_thread::yield();
+        }
+        // The actors have stopped by now, so this empties the queues.
+        transitions += hub.drain();
+    };
+
+    std::thread learner;
+    if (args.actorLearner)
+        learner = std::thread{learn};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < args.threads; ++i)
+        threads.emplace_back(play, i);
+    long lastFrames = 0;
+    double lastSeconds = 0;
+    while (!stop && (seconds <= 0 || getSeconds(start) < seconds))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{100});
+        if (results && getSeconds(start) - lastSeconds >= reportSeconds)
+        {
+            long frames = getFrames();
+            double now = getSeconds(start);
+            std::cout << "Frames/s: "
+                      << (frames - lastFrames) / (now - lastSeconds) << " ("
+                      << args.threads << " threads, " << args.envs
+                      << " games each)" << std::endl;
+            lastFrames = frames;
+            lastSeconds = now;
+        }
+    }
+    // The actors may be waiting on full queues, so the learner thread keeps
+    // draining them until they have all stopped.
+    stop = true;
+    for (auto& thread : threads)
+        thread.join();
+    stopLearner = true;
+    if (learner.joinable())
+        learner.join();
+
+    for (const auto& agent : agents)
+    {
+        decisions += agent->getDecisionCount();
+        emulatorSeconds += agent->getEmulatorSeconds();
+    }
+
+    TrainingThroughput throughput;
+    throughput.threads = args.threads;
+    throughput.frames = getFrames();
+    throughput.decisions = decisions;
+    throughput.episodes = episode;
+    throughput.seconds = getSeconds(start);
+    throughput.emulatorSeconds = emulatorSeconds;
+    throughput.transitions = transitions;
+    throughput.averageQueueDepth = hub.getAverageQueueDepth();
+    throughput.maxQueueDepth = hub.getMaxQueueDepth();
+    if (isSaving)
+    {
+        if (args.actorLearner)
+            hub.save();
+        else
+            tables.save();
+    }
+    return throughput;
+}
+}
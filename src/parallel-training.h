@@ -0,0 +1,45 @@
+#pragma once
+
+#include <iostream>
+
+#include "args.h"
+
+namespace Qbert {
+
+// The amount of work done by a training run.
+struct TrainingThroughput
+{
+    int threads{0};
+    long frames{0};
+    long decisions{0};
+    int episodes{0};
+    double seconds{0};
+
+    // The time spent in the emulator, summed over the threads.
+    double emulatorSeconds{0};
+
+    // The transitions applied by the learner thread and the depth of the
+    // queues when it drained them, in the actor-learner architecture.
+    long transitions{0};
+    double averageQueueDepth{0};
+    long maxQueueDepth{0};
+};
+
+// Trains the agent given by the arguments on args.threads threads. Each thread
+// plays args.envs copies of the game in lockstep, each with its own agent, and
+// has its own random stream. All the agents share the learners' tables. The
+// tables are saved every time each game has finished an episode on average,
+// and at the end of the run, unless they are frozen or discarded.
+//
+// With args.actorLearner, the threads are actors that never write to the
+// tables. They act from snapshots of the tables and send their transitions
+// through lock-free queues to a separate learner thread, which is the only one
+// to update the tables.
+//
+// The scores are written to the given results stream, if any, as the episodes
+// finish, and the throughput is printed to std::cout every few seconds in that
+// case. Runs for the given number of seconds, or forever if it is 0, and also
+// stops after args.episodes episodes or args.frames frames if they are set.
+TrainingThroughput
+    trainInParallel(const Args& args, double seconds, std::ostream* results);
+}
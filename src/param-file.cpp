@@ -0,0 +1,121 @@
+#include "param-file.h"
+
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+
+#include <dirent.h>
+
+namespace Qbert {
+
+std::vector<std::string> listParamFiles()
+{
+    std::vector<std::string> names;
+    auto dir = opendir("params");
+    if (dir == nullptr)
+        throw std::runtime_error{"cannot open the params/ directory"};
+    const std::string extension{".param"};
+    while (auto entry = readdir(dir))
+    {
+        std::string file{entry->d_name};
+        if (file.size() > extension.size() &&
+            file.compare(
+                file.size() - extension.size(),
+                extension.size(),
+                extension) == 0)
+            names.push_back(file.substr(0, file.size() - extension.size()));
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+long getParamFileSize(const std::string& name)
+{
+    std::ifstream is{"params/" + name + ".param", std::ios::binary};
+    if (!is)
+        return -1;
+    is.seekg(0, std::ios::end);
+    return static_cast<long>(is.tellg());
+}
+
+bool paramFileExists(const std::string& name)
+{
+    return static_cast<bool>(std::ifstream{"params/" + name + ".param"});
+}
+
+ParamTable readParamFile(const std::string& name)
+{
+    ParamTable table;
+    std::ifstream is{"params/" + name + ".param"};
+    if (!is)
+        return table;
+    int size;
+    is >> size;
+    for (int i = 0; i < size; ++i)
+    {
+        int state;
+        is >> state;
+        readRow(is, table[state].utilities);
+    }
+    is >> size;
+    for (int i = 0; i < size; ++i)
+    {
+        int state;
+        is >> state;
+        readRow(is, table[state].visited);
+    }
+    return table;
+}
+
+void writeParamFile(const std::string& name, const ParamTable& table)
+{
+    auto hasUtilities = [](const ParamTable::value_type& p) {
+        const auto& utilities = p.second.utilities;
+        return std::any_of(utilities.begin(), utilities.end(), [](float u) {
+            return u != 0;
+        });
+    };
+    auto hasVisited = [](const ParamTable::value_type& p) {
+        const auto& visited = p.second.visited;
+        return std::any_of(visited.begin(), visited.end(), [](int n) {
+            return n != 0;
+        });
+    };
+
+    // The states are written in order, so that the file can be merged as a
+    // stream.
+    std::vector<int> states;
+    states.reserve(table.size());
+    for (const auto& p : table)
+        states.push_back(p.first);
+    std::sort(states.begin(), states.end());
+
+    std::ofstream os{"params/" + name + ".param.temp"};
+    os << std::count_if(table.begin(), table.end(), hasUtilities) << std::endl;
+    for (int state : states)
+    {
+        const auto& p = *table.find(state);
+        if (!hasUtilities(p))
+            continue;
+        os << p.first << " ";
+        writeRow(os, p.second.utilities);
+        os << std::endl;
+    }
+    os << std::count_if(table.begin(), table.end(), hasVisited) << std::endl;
+    for (int state : states)
+    {
+        const auto& p = *table.find(state);
+        if (!hasVisited(p))
+            continue;
+        os << p.first << " ";
+        writeRow(os, p.second.visited);
+        os << std::endl;
+    }
+    os.close();
+    rename(
+        ("params/" + name + ".param.temp").c_str(),
+        ("params/" + name + ".param").c_str());
+}
+}
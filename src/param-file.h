@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+
+#include "q-table.h"
+
+namespace Qbert {
+
+// The entries of a param file indexed by encoded state.
+using ParamTable = std::unordered_map<int, QEntry>;
+
+// The rows in the param files start with a column for the NOOP action, which
+// is never taken, so that they stay compatible with older tables.
+
+// Reads a row of a param file, without the state.
+template <typename Row>
+void readRow(std::istream& is, Row& row)
+{
+    typename Row::value_type noop;
+    is >> noop;
+    for (auto& value : row)
+        is >> value;
+}
+
+// Writes a row of a param file, without the state.
+template <typename Row>
+void writeRow(std::ostream& os, const Row& row)
+{
+    os << 0 << " ";
+    for (const auto& value : row)
+        os << value << " ";
+}
+
+// Returns the names of the param files in the params/ directory.
+std::vector<std::string> listParamFiles();
+
+// Returns the size of the param file in bytes, or -1 if it does not exist.
+long getParamFileSize(const std::string& name);
+
+// Returns true if the param file exists.
+bool paramFileExists(const std::string& name);
+
+// Reads the param file with the given name from the params/ directory. Returns
+// an empty table if the file does not exist.
+ParamTable readParamFile(const std::string& name);
+
+// Writes the param file with the given name to the params/ directory.
+void writeParamFile(const std::string& name, const ParamTable& table);
+}
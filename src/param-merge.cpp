@@ -0,0 +1,380 @@
+#include "param-merge.h"
+
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <cstdio>
+
+#include "param-file.h"
+
+namespace Qbert {
+
+// The visit counts saturate here, in the same way as in the learner.
+static constexpr long maxVisited = 999999999;
+
+// The number of rows sorted in memory at a time for unsorted inputs.
+static constexpr std::size_t sortChunkRows = 1 << 20;
+
+// Reads the rows of one section of a param file in order. Section 0 holds the
+// utilities and section 1 holds the visit counts. A file with a single section
+// is read as section 0.
+template <typename Row>
+class SectionReader
+{
+    std::ifstream is;
+    int remaining{0};
+
+public:
+    SectionReader(const std::string& path, int section) : is{path}
+    {
+        if (!is)
+            throw std::runtime_error{"cannot open param file " + path};
+        is >> remaining;
+        if (section == 1)
+        {
+            QEntry::UtilityRow skipped;
+            int state;
+            for (; remaining > 0; --remaining)
+            {
+                is >> state;
+                readRow(is, skipped);
+            }
+            is >> remaining;
+        }
+    }
+
+    // Reads the next row. Returns false at the end of the section.
+    bool next(int& state, Row& row)
+    {
+        if (remaining <= 0)
+            return false;
+        --remaining;
+        is >> state;
+        readRow(is, row);
+        if (!is)
+            throw std::runtime_error{"truncated param file"};
+        return true;
+    }
+};
+
+// Writes a file with a single section, for the sorted runs of a section.
+template <typename Row>
+static void writeSection(
+    const std::string& path, const std::vector<std::pair<int, Row>>& rows)
+{
+    std::ofstream os{path};
+    os << rows.size() << std::endl;
+    for (const auto& p : rows)
+    {
+        os << p.first << " ";
+        writeRow(os, p.second);
+        os << std::endl;
+    }
+}
+
+// Calls the given function for each row of the given readers in order of
+// state. Rows with the same state are visited in order of reader.
+template <typename Reader, typename Row>
+static void mergeReaders(
+    std::vector<std::unique_ptr<Reader>>& readers,
+    const std::function<void(int state, const Row& row)>& f)
+{
+    struct Head
+    {
+        int state;
+        std::size_t reader;
+        Row row;
+    };
+    auto isAfter = [](const Head& lhs, const Head& rhs) {
+        return lhs.state != rhs.state ? lhs.state > rhs.state
+                                      : lhs.reader > rhs.reader;
+    };
+    std::priority_queue<Head, std::vector<Head>, decltype(isAfter)> heads{
+        isAfter};
+    for (std::size_t i = 0; i < readers.size(); ++i)
+    {
+        Head head{0, i, Row{}};
+        if (readers[i]->next(head.state, head.row))
+            heads.push(head);
+    }
+    while (!heads.empty())
+    {
+        auto head = heads.top();
+        heads.pop();
+        f(head.state, head.row);
+        if (readers[head.reader]->next(head.state, head.row))
+            heads.push(head);
+    }
+}
+
+// A section of an input that can be read in order of state.
+struct SortedSection
+{
+    std::string path;
+    int section;
+    std::vector<std::string> temporaryFiles;
+};
+
+// Returns a version of the section of the given param file that is sorted by
+// state. If the section is not sorted already, it is sorted in chunks that are
+// written to temporary files and merged.
+template <typename Row>
+static SortedSection sortSection(
+    const std::string& path, int section, const std::string& tempPrefix)
+{
+    {
+        SectionReader<Row> reader{path, section};
+        int state, lastState = -1;
+        Row row;
+        bool isSorted = true;
+        while (isSorted && reader.next(state, row))
+        {
+            isSorted = state >= lastState;
+            lastState = state;
+        }
+        if (isSorted)
+            return {path, section, {}};
+    }
+
+    // A stable sort keeps the rows for the same state in file order, so that
+    // later rows still replace earlier ones.
+    SortedSection sorted{tempPrefix + ".sorted", 0, {}};
+    SectionReader<Row> reader{path, section};
+    std::vector<std::pair<int, Row>> rows;
+    bool isDone = false;
+    while (!isDone)
+    {
+        rows.clear();
+        std::pair<int, Row> p;
+        while (rows.size() < sortChunkRows &&
+               !(isDone = !reader.next(p.first, p.second)))
+            rows.push_back(p);
+        if (rows.empty())
+            break;
+        std::stable_sort(rows.begin(), rows.end(), [](auto lhs, auto rhs) {
+            return lhs.first < rhs.first;
+        });
+        auto run = tempPrefix + ".run" +
+            std::to_string(sorted.temporaryFiles.size());
+        writeSection(run, rows);
+        sorted.temporaryFiles.push_back(run);
+    }
+
+    std::vector<std::unique_ptr<SectionReader<Row>>> runs;
+    for (const auto& run : sorted.temporaryFiles)
+        runs.push_back(std::make_unique<SectionReader<Row>>(run, 0));
+    std::string body = tempPrefix + ".body";
+    int count = 0;
+    {
+        std::ofstream os{body};
+        mergeReaders<SectionReader<Row>, Row>(
+            runs, [&](int state, const Row& row) {
+                os << state << " ";
+                writeRow(os, row);
+                os << std::endl;
+                ++count;
+            });
+    }
+    runs.clear();
+    {
+        std::ofstream os{sorted.path};
+        std::ifstream is{body};
+        os << count << std::endl;
+        if (count > 0)
+            os << is.rdbuf();
+    }
+    remove(body.c_str());
+    for (const auto& run : sorted.temporaryFiles)
+        remove(run.c_str());
+    sorted.temporaryFiles = {sorted.path};
+    return sorted;
+}
+
+// Reads the rows of a sorted section with a single row for each state, keeping
+// the last one.
+template <typename Row>
+class UniqueSectionReader
+{
+    SectionReader<Row> reader;
+    bool hasNext;
+    int nextState{0};
+    Row nextRow{};
+
+public:
+    explicit UniqueSectionReader(const SortedSection& section)
+        : reader{section.path, section.section}
+    {
+        hasNext = reader.next(nextState, nextRow);
+    }
+
+    bool next(int& state, Row& row)
+    {
+        if (!hasNext)
+            return false;
+        state = nextState;
+        row = nextRow;
+        while ((hasNext = reader.next(nextState, nextRow)) &&
+               nextState == state)
+            row = nextRow;
+        return true;
+    }
+};
+
+// Reads the entries of an input in order of state by joining its utilities and
+// visit counts.
+class InputReader
+{
+    UniqueSectionReader<QEntry::UtilityRow> utilities;
+    UniqueSectionReader<QEntry::VisitRow> visited;
+    int utilityState{0}, visitedState{0};
+    QEntry::UtilityRow utilityRow{};
+    QEntry::VisitRow visitedRow{};
+    bool hasUtilities, hasVisited;
+
+public:
+    InputReader(const SortedSection& utilitySection,
+                const SortedSection& visitedSection)
+        : utilities{utilitySection}, visited{visitedSection}
+    {
+        hasUtilities = utilities.next(utilityState, utilityRow);
+        hasVisited = visited.next(visitedState, visitedRow);
+    }
+
+    bool next(int& state, QEntry& entry)
+    {
+        if (!hasUtilities && !hasVisited)
+            return false;
+        if (!hasVisited || (hasUtilities && utilityState <= visitedState))
+            state = utilityState;
+        else
+            state = visitedState;
+        entry = QEntry{};
+        if (hasUtilities && utilityState == state)
+        {
+            entry.utilities = utilityRow;
+            hasUtilities = utilities.next(utilityState, utilityRow);
+        }
+        if (hasVisited && visitedState == state)
+        {
+            entry.visited = visitedRow;
+            hasVisited = visited.next(visitedState, visitedRow);
+        }
+        return true;
+    }
+};
+
+void mergeEntries(QEntry& target, const QEntry& source)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        long n1 = target.visited[i];
+        long n2 = source.visited[i];
+        // Utilities without any visits can only come from corrections, so we
+        // give both sides the same weight in that case.
+        target.utilities[i] = n1 + n2 == 0
+            ? (target.utilities[i] + source.utilities[i]) / 2
+            : (target.utilities[i] * n1 + source.utilities[i] * n2) / (n1 + n2);
+        target.visited[i] = std::min(n1 + n2, maxVisited);
+    }
+}
+
+int mergeParamFiles(
+    const std::vector<std::string>& inputPaths, const std::string& outputPath)
+{
+    std::vector<std::string> temporaryFiles;
+    std::vector<std::unique_ptr<InputReader>> inputs;
+    for (const auto& path : inputPaths)
+    {
+        if (!std::ifstream{path})
+            continue;
+        auto prefix = outputPath + ".input" + std::to_string(inputs.size());
+        auto utilitySection = sortSection<QEntry::UtilityRow>(
+            path, 0, prefix + ".utilities");
+        auto visitedSection =
+            sortSection<QEntry::VisitRow>(path, 1, prefix + ".visited");
+        for (const auto& section : {utilitySection, visitedSection})
+            temporaryFiles.insert(
+                temporaryFiles.end(),
+                section.temporaryFiles.begin(),
+                section.temporaryFiles.end());
+        inputs.push_back(
+            std::make_unique<InputReader>(utilitySection, visitedSection));
+    }
+    if (inputs.empty())
+        return 0;
+
+    // The sections are written to separate files first, since the row counts
+    // at the start of each section are only known at the end.
+    auto utilityPath = outputPath + ".utilities";
+    auto visitedPath = outputPath + ".visited";
+    int utilityCount = 0, visitedCount = 0;
+    {
+        std::ofstream utilityStream{utilityPath};
+        std::ofstream visitedStream{visitedPath};
+        auto write = [&](int state, const QEntry& entry) {
+            if (std::any_of(
+                    entry.utilities.begin(),
+                    entry.utilities.end(),
+                    [](float u) { return u != 0; }))
+            {
+                utilityStream << state << " ";
+                writeRow(utilityStream, entry.utilities);
+                utilityStream << std::endl;
+                ++utilityCount;
+            }
+            if (std::any_of(
+                    entry.visited.begin(),
+                    entry.visited.end(),
+                    [](int n) { return n != 0; }))
+            {
+                visitedStream << state << " ";
+                writeRow(visitedStream, entry.visited);
+                visitedStream << std::endl;
+                ++visitedCount;
+            }
+        };
+
+        bool hasEntry = false;
+        int mergedState = 0;
+        QEntry merged;
+        mergeReaders<InputReader, QEntry>(
+            inputs, [&](int state, const QEntry& entry) {
+                if (hasEntry && state == mergedState)
+                {
+                    mergeEntries(merged, entry);
+                    return;
+                }
+                if (hasEntry)
+                    write(mergedState, merged);
+                hasEntry = true;
+                mergedState = state;
+                merged = entry;
+            });
+        if (hasEntry)
+            write(mergedState, merged);
+    }
+    int count = inputs.size();
+    inputs.clear();
+
+    {
+        std::ofstream os{outputPath + ".temp"};
+        std::ifstream utilityStream{utilityPath};
+        std::ifstream visitedStream{visitedPath};
+        os << utilityCount << std::endl;
+        if (utilityCount > 0)
+            os << utilityStream.rdbuf();
+        os << visitedCount << std::endl;
+        if (visitedCount > 0)
+            os << visitedStream.rdbuf();
+    }
+    rename((outputPath + ".temp").c_str(), outputPath.c_str());
+    remove(utilityPath.c_str());
+    remove(visitedPath.c_str());
+    for (const auto& file : temporaryFiles)
+        remove(file.c_str());
+    return count;
+}
+}
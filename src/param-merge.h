@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "q-table.h"
+
+namespace Qbert {
+
+// Merges the source entry into the target entry. The visit counts are summed,
+// and the utilities are averaged with weights given by the visit counts.
+void mergeEntries(QEntry& target, const QEntry& source);
+
+// Merges the param files at the given paths into a single param file at the
+// output path, skipping the inputs that don't exist. Returns the number of
+// inputs merged.
+//
+// The inputs are streamed in order of state, so memory use is bounded by the
+// number of inputs rather than by the size of the tables. Inputs that are not
+// sorted by state, such as older tables or tables with spilled states, are
+// first sorted in bounded memory through temporary files next to the output.
+// Later rows for the same state in a single input replace earlier ones, in the
+// same way as when a learner loads the file.
+int mergeParamFiles(
+    const std::vector<std::string>& inputPaths, const std::string& outputPath);
+}
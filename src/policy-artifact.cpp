@@ -0,0 +1,250 @@
+#include "policy-artifact.h"
+
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Qbert {
+
+static constexpr std::uint32_t artifactMagic = 0x51425254; // "QBRT"
+static constexpr std::uint32_t artifactVersion = 2;
+
+// The average number of states per bucket. Larger buckets make the
+// displacement array smaller, but make the artifact slower to build.
+static constexpr std::uint32_t statesPerBucket = 4;
+
+// The number of displacements tried for a bucket before the slots are grown.
+// With a slot for each state, the last buckets have few free slots left, so
+// large tables can need more tries than this.
+static constexpr std::uint32_t maxDisplacement = 1 << 16;
+
+// Mixes the state with the given seed. This is the SplitMix64 finalizer.
+static std::uint64_t mix(int state, std::uint64_t seed)
+{
+    std::uint64_t hash = static_cast<std::uint32_t>(state) +
+        0x9E3779B97F4A7C15ull * (seed + 1);
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    return hash ^ (hash >> 31);
+}
+
+// Returns the offset of the records, which are aligned to their size.
+static std::size_t getRecordOffset(std::uint32_t bucketCount)
+{
+    std::size_t offset = sizeof(PolicyArtifact::Header) +
+        bucketCount * sizeof(std::uint32_t);
+    constexpr std::size_t alignment = alignof(PolicyArtifact::Record);
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+PolicyArtifact::PolicyArtifact(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error{"cannot open policy artifact " + path};
+    struct stat info;
+    if (fstat(fd, &info) < 0 ||
+        static_cast<std::size_t>(info.st_size) < sizeof(Header))
+    {
+        close(fd);
+        throw std::runtime_error{"invalid policy artifact " + path};
+    }
+    length = info.st_size;
+    data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        throw std::runtime_error{"cannot map policy artifact " + path};
+
+    header = static_cast<const Header*>(data);
+    if (header->magic != artifactMagic || header->version != artifactVersion ||
+        header->slotCount < header->size ||
+        length < getRecordOffset(header->bucketCount) +
+                header->slotCount * sizeof(Record))
+    {
+        munmap(data, length);
+        throw std::runtime_error{"invalid policy artifact " + path};
+    }
+    auto bytes = static_cast<const char*>(data);
+    displacements =
+        reinterpret_cast<const std::uint32_t*>(bytes + sizeof(Header));
+    records = reinterpret_cast<const Record*>(
+        bytes + getRecordOffset(header->bucketCount));
+}
+
+PolicyArtifact::~PolicyArtifact()
+{
+    munmap(data, length);
+}
+
+const float* PolicyArtifact::find(int state) const
+{
+    alignas(16) static const QEntry::UtilityRow defaultUtilities{};
+    if (header->size == 0)
+        return defaultUtilities.data();
+    auto displacement =
+        displacements[getBucket(state, header->bucketCount)];
+    const auto& record =
+        records[getSlot(state, displacement, header->slotCount)];
+    return record.state == state ? record.utilities.data()
+                                 : defaultUtilities.data();
+}
+
+void PolicyArtifact::prefetch(int state) const
+{
+    if (header->size != 0)
+        __builtin_prefetch(
+            &displacements[getBucket(state, header->bucketCount)]);
+}
+
+std::size_t PolicyArtifact::size() const
+{
+    return header->size;
+}
+
+std::size_t PolicyArtifact::getMemoryUsage() const
+{
+    return length;
+}
+
+void PolicyArtifact::write(const std::string& path, const ParamTable& table)
+{
+    std::vector<int> states;
+    for (const auto& p : table)
+    {
+        const auto& entry = p.second;
+        if (std::any_of(
+                entry.utilities.begin(),
+                entry.utilities.end(),
+                [](float u) { return u != 0; }) ||
+            std::any_of(
+                entry.visited.begin(),
+                entry.visited.end(),
+                [](int n) { return n != 0; }))
+            states.push_back(p.first);
+    }
+
+    // We use the hash and displace method: the states are split into buckets,
+    // and starting from the largest bucket, each bucket searches for a
+    // displacement that sends all of its states to free slots.
+    Header header{artifactMagic,
+                  artifactVersion,
+                  static_cast<std::uint32_t>(states.size()),
+                  static_cast<std::uint32_t>(
+                      states.size() / statesPerBucket + 1),
+                  static_cast<std::uint32_t>(states.size())};
+    std::vector<std::vector<int>> buckets(header.bucketCount);
+    for (auto state : states)
+        buckets[getBucket(state, header.bucketCount)].push_back(state);
+    std::vector<std::uint32_t> order(header.bucketCount);
+    for (std::uint32_t i = 0; i < header.bucketCount; ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](auto lhs, auto rhs) {
+        return buckets[lhs].size() > buckets[rhs].size();
+    });
+
+    // Each failed search grows the slots by an eighth, which makes the last
+    // buckets much easier to place.
+    std::vector<std::uint32_t> displacements(header.bucketCount, 0);
+    std::vector<std::int32_t> slotStates(header.slotCount, -1);
+    while (!displace(buckets, order, displacements, slotStates))
+    {
+        header.slotCount += header.slotCount / 8 + 1;
+        slotStates.assign(header.slotCount, -1);
+    }
+    std::vector<Record> records(header.slotCount);
+    for (std::uint32_t i = 0; i < header.slotCount; ++i)
+    {
+        records[i].state = slotStates[i];
+        if (slotStates[i] != -1)
+            records[i].utilities = table.at(slotStates[i]).utilities;
+    }
+
+    std::ofstream os{path + ".temp", std::ios::binary};
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    os.write(
+        reinterpret_cast<const char*>(displacements.data()),
+        displacements.size() * sizeof(std::uint32_t));
+    std::vector<char> padding(
+        getRecordOffset(header.bucketCount) - sizeof(header) -
+            displacements.size() * sizeof(std::uint32_t),
+        0);
+    os.write(padding.data(), padding.size());
+    os.write(
+        reinterpret_cast<const char*>(records.data()),
+        records.size() * sizeof(Record));
+    os.close();
+    rename((path + ".temp").c_str(), path.c_str());
+}
+
+std::string PolicyArtifact::getPath(const std::string& name)
+{
+    return "params/" + name + ".policy";
+}
+
+bool PolicyArtifact::isCurrent(const std::string& name)
+{
+    struct stat policyInfo, paramInfo;
+    if (stat(getPath(name).c_str(), &policyInfo) < 0)
+        return false;
+    return stat(("params/" + name + ".param").c_str(), &paramInfo) < 0 ||
+        policyInfo.st_mtime >= paramInfo.st_mtime;
+}
+
+bool PolicyArtifact::displace(
+    const std::vector<std::vector<int>>& buckets,
+    const std::vector<std::uint32_t>& order,
+    std::vector<std::uint32_t>& displacements,
+    std::vector<std::int32_t>& slotStates)
+{
+    auto slotCount = static_cast<std::uint32_t>(slotStates.size());
+    std::vector<std::uint32_t> slots;
+    for (auto bucket : order)
+    {
+        if (buckets[bucket].empty())
+            break;
+        bool isPlaced = false;
+        for (std::uint32_t displacement = 0; displacement < maxDisplacement;
+             ++displacement)
+        {
+            slots.clear();
+            for (auto state : buckets[bucket])
+            {
+                auto slot = getSlot(state, displacement, slotCount);
+                if (slotStates[slot] != -1 ||
+                    std::find(slots.begin(), slots.end(), slot) != slots.end())
+                    break;
+                slots.push_back(slot);
+            }
+            if (slots.size() != buckets[bucket].size())
+                continue;
+
+            displacements[bucket] = displacement;
+            for (std::size_t i = 0; i < slots.size(); ++i)
+                slotStates[slots[i]] = buckets[bucket][i];
+            isPlaced = true;
+            break;
+        }
+        if (!isPlaced)
+            return false;
+    }
+    return true;
+}
+
+std::uint32_t PolicyArtifact::getBucket(int state, std::uint32_t bucketCount)
+{
+    return mix(state, 0) % bucketCount;
+}
+
+std::uint32_t PolicyArtifact::getSlot(
+    int state, std::uint32_t displacement, std::uint32_t slotCount)
+{
+    return mix(state, displacement + 1) % slotCount;
+}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "param-file.h"
+
+namespace Qbert {
+
+// An immutable, memory-mapped policy for inference. The utilities of the
+// visited states are stored in a flat array indexed by a perfect hash of the
+// states, so a lookup costs two memory accesses: one for the hash displacement
+// and one for the record holding the state and its utilities. The array has a
+// slot for each state unless the hash can't be built that way, in which case
+// it is grown until it can.
+class PolicyArtifact
+{
+public:
+    struct Header
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t size;
+        std::uint32_t bucketCount;
+        std::uint32_t slotCount;
+    };
+
+    struct alignas(32) Record
+    {
+        QEntry::UtilityRow utilities;
+        std::int32_t state;
+    };
+
+private:
+    void* data{nullptr};
+    std::size_t length{0};
+    const Header* header{nullptr};
+    const std::uint32_t* displacements{nullptr};
+    const Record* records{nullptr};
+
+public:
+    // Maps the artifact at the given path into memory.
+    explicit PolicyArtifact(const std::string& path);
+
+    PolicyArtifact(const PolicyArtifact&) = delete;
+    PolicyArtifact& operator=(const PolicyArtifact&) = delete;
+
+    ~PolicyArtifact();
+
+    // Returns the utilities for the given state, or a shared all-zero row if
+    // the state was never visited.
+    const float* find(int state) const;
+
+    // Starts loading the hash displacement of the given state, so that a later
+    // lookup of the state waits for one memory access instead of two.
+    void prefetch(int state) const;
+
+    // Returns the number of states in the artifact.
+    std::size_t size() const;
+
+    // Returns the size of the artifact in bytes.
+    std::size_t getMemoryUsage() const;
+
+    // Builds the artifact for the given table and writes it to the given path.
+    // Only the states with at least one visit or utility are kept.
+    static void write(const std::string& path, const ParamTable& table);
+
+    // Returns the path of the artifact for the table with the given name.
+    static std::string getPath(const std::string& name);
+
+    // Returns true if the artifact for the table with the given name exists
+    // and is no older than the table's param file.
+    static bool isCurrent(const std::string& name);
+
+private:
+    // Returns the bucket of the given state.
+    static std::uint32_t getBucket(int state, std::uint32_t bucketCount);
+
+    // Returns the slot of the given state for the given displacement.
+    static std::uint32_t
+        getSlot(int state, std::uint32_t displacement, std::uint32_t slotCount);
+
+    // Searches each bucket, in the given order, for a displacement that sends
+    // all of its states to free slots, and fills in the state of each slot,
+    // or -1 for the free ones. Returns false if some bucket has no such
+    // displacement under the search limit.
+    static bool displace(
+        const std::vector<std::vector<int>>& buckets,
+        const std::vector<std::uint32_t>& order,
+        std::vector<std::uint32_t>& displacements,
+        std::vector<std::int32_t>& slotStates);
+};
+}
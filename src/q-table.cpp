@@ -0,0 +1,378 @@
+#include "q-table.h"
+
+#include <algorithm>
+#include <numeric>
+#include <limits>
+
+namespace Qbert {
+
+// The maximum access frequency tracked for a cache slot. This bounds how long a
+// formerly hot state can hold on to its slot.
+static constexpr int maxFrequency = 15;
+
+// The fraction of the budget that is freed every time the table goes over it.
+// Evicting in batches amortizes the cost of finding the coldest states.
+static constexpr float evictionFraction = 0.05f;
+
+// The initial number of buckets in the main table. The table doubles whenever
+// it becomes more than 3/4 full, to keep the probe sequences short.
+static constexpr std::size_t minBuckets = 16;
+
+constexpr int LearnerConfig::maxCacheSize;
+constexpr int LearnerConfig::maxStatesLimit;
+constexpr float LearnerConfig::maxTableMegabytesLimit;
+
+QTable::QTable(const LearnerConfig& config) : eviction{config.eviction}
+{
+    if (config.cacheSize > 0)
+    {
+        int size = 1;
+        cacheShift = 32;
+        while (size < config.cacheSize)
+        {
+            size <<= 1;
+            --cacheShift;
+        }
+        cache.resize(size);
+    }
+
+    if (config.maxStates > 0)
+        maxStates = config.maxStates;
+    if (config.maxTableMegabytes > 0)
+    {
+        std::size_t budget = std::max<std::size_t>(
+            config.maxTableMegabytes * 1024 * 1024 / getEntryMemoryUsage(), 1);
+        maxStates = maxStates == 0 ? budget : std::min(maxStates, budget);
+    }
+    rehash(minBuckets);
+}
+
+const QEntry& QTable::find(int state)
+{
+    static const QEntry defaultEntry{};
+    ++clock;
+    auto slot = access(state);
+    if (slot != nullptr)
+        return slot->entry;
+    long bucket = load(state);
+    if (bucket == -1)
+        return defaultEntry;
+    auto& record = buckets[bucket].record;
+    record.lastAccess = clock;
+    return record.entry;
+}
+
+QEntry& QTable::get(int state)
+{
+    ++clock;
+    auto slot = access(state);
+    if (slot != nullptr)
+    {
+        slot->dirty = true;
+        return slot->entry;
+    }
+    auto& record = insert(state);
+    record.lastAccess = clock;
+    return record.entry;
+}
+
+void QTable::flush()
+{
+    for (auto& slot : cache)
+        writeBack(slot);
+}
+
+void QTable::forEach(
+    const std::function<void(int state, const QEntry& entry)>& f)
+{
+    flush();
+    // We visit the states in order, so that the param files are written sorted
+    // and can be merged as streams.
+    std::vector<std::pair<int, std::size_t>> states;
+    states.reserve(count);
+    for (std::size_t i = 0; i < buckets.size(); ++i)
+        if (buckets[i].state != -1)
+            states.emplace_back(buckets[i].state, i);
+    std::sort(states.begin(), states.end());
+    for (const auto& p : states)
+        f(p.first, buckets[p.second].record.entry);
+}
+
+int QTable::compact()
+{
+    flush();
+    for (auto& slot : cache)
+        slot = Slot{};
+
+    int removed = 0;
+    for (auto& bucket : buckets)
+    {
+        const auto& entry = bucket.record.entry;
+        if (bucket.state != -1 &&
+            std::all_of(
+                entry.utilities.begin(),
+                entry.utilities.end(),
+                [](float u) { return u == 0; }) &&
+            std::all_of(
+                entry.visited.begin(),
+                entry.visited.end(),
+                [](int n) { return n == 0; }))
+        {
+            bucket.state = -1;
+            ++removed;
+        }
+    }
+    // Rebuilding the table both closes the gaps in the probe sequences and
+    // shrinks it to fit the remaining entries.
+    count -= removed;
+    std::size_t size = minBuckets;
+    while (count * 4 > size * 3)
+        size *= 2;
+    rehash(size);
+    return removed;
+}
+
+void QTable::setEvictionHandler(
+    std::function<void(int state, const QEntry& entry)> handler)
+{
+    evictionHandler = handler;
+}
+
+void QTable::setMissHandler(
+    std::function<bool(int state, QEntry& entry)> handler)
+{
+    missHandler = handler;
+}
+
+std::size_t QTable::size()
+{
+    flush();
+    return count;
+}
+
+std::size_t QTable::getMemoryUsage()
+{
+    return buckets.size() * sizeof(Bucket) + cache.size() * sizeof(Slot);
+}
+
+float QTable::getCacheHitRate()
+{
+    return hits + misses == 0 ? 0 : static_cast<float>(hits) / (hits + misses);
+}
+
+long QTable::getEvictionCount()
+{
+    return evictions;
+}
+
+void QTable::resetStatistics()
+{
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+}
+
+std::size_t QTable::getEntryMemoryUsage()
+{
+    // The table is between 3/8 and 3/4 full, so each entry takes up to two
+    // buckets.
+    return 2 * sizeof(Bucket);
+}
+
+void QTable::prefetch(int state)
+{
+    // A state is usually found in its home bucket, so that is the only one
+    // that is prefetched.
+    if (!cache.empty())
+        __builtin_prefetch(&getSlot(state));
+    __builtin_prefetch(&buckets[getHomeBucket(state)]);
+}
+
+QTable::Slot& QTable::getSlot(int state)
+{
+    static Slot noSlot;
+    if (cache.empty())
+        return noSlot;
+    // Fibonacci hashing spreads the structured state encodings over the slots.
+    auto hash = static_cast<std::uint32_t>(state) * 2654435769u;
+    return cache[cacheShift == 32 ? 0 : hash >> cacheShift];
+}
+
+QTable::Slot* QTable::access(int state)
+{
+    if (cache.empty())
+        return nullptr;
+
+    auto& slot = getSlot(state);
+    if (slot.state == state)
+    {
+        ++hits;
+        slot.frequency = std::min(slot.frequency + 1, maxFrequency);
+        return &slot;
+    }
+
+    ++misses;
+    // The occupant of the slot ages on every conflicting access, so that a
+    // state that is accessed more often eventually takes its place.
+    if (slot.frequency > 0)
+        --slot.frequency;
+    if (slot.frequency > 0)
+        return nullptr;
+
+    writeBack(slot);
+    long bucket = load(state);
+    slot.state = state;
+    slot.frequency = 1;
+    slot.dirty = false;
+    slot.entry = bucket == -1 ? QEntry{} : buckets[bucket].record.entry;
+    return &slot;
+}
+
+std::size_t QTable::getHomeBucket(int state) const
+{
+    // This is the same Fibonacci hash used for the cache.
+    return static_cast<std::uint32_t>(state) * 2654435769u >> bucketShift;
+}
+
+long QTable::findBucket(int state) const
+{
+    std::size_t mask = buckets.size() - 1;
+    for (auto i = getHomeBucket(state);; i = (i + 1) & mask)
+    {
+        if (buckets[i].state == state)
+            return i;
+        if (buckets[i].state == -1)
+            return -1;
+    }
+}
+
+void QTable::erase(std::size_t bucket)
+{
+    // An entry can move into the hole if the hole lies between its home
+    // bucket and its current bucket, cyclically.
+    std::size_t mask = buckets.size() - 1;
+    auto hole = bucket;
+    for (auto i = (hole + 1) & mask; buckets[i].state != -1; i = (i + 1) & mask)
+    {
+        auto home = getHomeBucket(buckets[i].state);
+        if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+            buckets[hole] = buckets[i];
+            hole = i;
+        }
+    }
+    buckets[hole].state = -1;
+    --count;
+}
+
+void QTable::rehash(std::size_t size)
+{
+    std::vector<Bucket> old(size);
+    old.swap(buckets);
+    bucketShift = 32;
+    for (auto n = size; n > 1; n >>= 1)
+        --bucketShift;
+    std::size_t mask = size - 1;
+    for (const auto& bucket : old)
+    {
+        if (bucket.state == -1)
+            continue;
+        auto i = getHomeBucket(bucket.state);
+        while (buckets[i].state != -1)
+            i = (i + 1) & mask;
+        buckets[i] = bucket;
+    }
+}
+
+void QTable::writeBack(Slot& slot)
+{
+    if (slot.dirty)
+    {
+        auto& record = insert(slot.state);
+        record.entry = slot.entry;
+        record.lastAccess = clock;
+        slot.dirty = false;
+    }
+}
+
+long QTable::load(int state)
+{
+    long bucket = findBucket(state);
+    QEntry entry;
+    if (bucket != -1 || !missHandler || !missHandler(state, entry))
+        return bucket;
+    bucket = insertNew(state);
+    buckets[bucket].record.entry = entry;
+    return bucket;
+}
+
+QTable::Record& QTable::insert(int state)
+{
+    long bucket = load(state);
+    if (bucket == -1)
+        bucket = insertNew(state);
+    return buckets[bucket].record;
+}
+
+std::size_t QTable::insertNew(int state)
+{
+    if ((count + 1) * 4 > buckets.size() * 3)
+        rehash(buckets.size() * 2);
+    std::size_t mask = buckets.size() - 1;
+    auto i = getHomeBucket(state);
+    while (buckets[i].state != -1)
+        i = (i + 1) & mask;
+    buckets[i].state = state;
+    buckets[i].record = Record{};
+    ++count;
+    if (maxStates > 0 && count > maxStates)
+    {
+        // The eviction can shift the new entry back along its probe sequence.
+        evict(state);
+        i = findBucket(state);
+    }
+    return i;
+}
+
+void QTable::evict(int keep)
+{
+    // States in the cache are hot by definition, and clean cache slots rely on
+    // the main table holding their entry.
+    auto isProtected = [&](int state) {
+        return state == keep ||
+            (!cache.empty() && getSlot(state).state == state);
+    };
+    auto coldness = [&](const Record& record) -> std::uint64_t {
+        if (eviction == EvictionPolicy::LeastVisited)
+            return std::accumulate(
+                record.entry.visited.begin(),
+                record.entry.visited.end(),
+                std::uint64_t{0});
+        // The clock can wrap around, so we measure the age of each access.
+        return std::numeric_limits<std::uint32_t>::max() -
+            (clock - record.lastAccess);
+    };
+
+    std::vector<std::pair<std::uint64_t, int>> candidates;
+    candidates.reserve(count);
+    for (const auto& bucket : buckets)
+        if (bucket.state != -1 && !isProtected(bucket.state))
+            candidates.emplace_back(coldness(bucket.record), bucket.state);
+
+    std::size_t target = maxStates -
+        std::max<std::size_t>(maxStates * evictionFraction, 1);
+    std::size_t evicted =
+        std::min(candidates.size(), count > target ? count - target : 0);
+    std::nth_element(
+        candidates.begin(), candidates.begin() + evicted, candidates.end());
+    for (std::size_t i = 0; i < evicted; ++i)
+    {
+        long bucket = findBucket(candidates[i].second);
+        if (evictionHandler)
+            evictionHandler(
+                candidates[i].second, buckets[bucket].record.entry);
+        erase(bucket);
+    }
+    evictions += evicted;
+}
+}
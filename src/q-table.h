@@ -0,0 +1,173 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include "learner-config.h"
+
+namespace Qbert {
+
+// The utilities and visit counts of the actions in a single state. The rows
+// hold the UP, RIGHT, LEFT, and DOWN actions in that order, and are aligned so
+// that they can be loaded as a single SIMD register.
+struct QEntry
+{
+    using UtilityRow = std::array<float, 4>;
+    using VisitRow = std::array<int, 4>;
+
+    alignas(16) UtilityRow utilities{};
+    alignas(16) VisitRow visited{};
+};
+
+// A table of Q-learning entries indexed by encoded state. The main table is an
+// open-addressed hash table with linear probing, so that the bucket of a state
+// can be located, and prefetched, without reading memory. A small
+// direct-mapped cache of hot states sits in front of the main table. A
+// state is promoted into its cache slot once it is accessed more often than the
+// state currently occupying the slot, and modified entries are written back to
+// the main table when they are evicted.
+//
+// The main table can be given a budget, in which case the coldest states are
+// evicted in batches whenever it grows past the budget.
+class QTable
+{
+    struct Record
+    {
+        QEntry entry;
+        std::uint32_t lastAccess{0};
+    };
+
+    struct Slot
+    {
+        int state{-1};
+        int frequency{0};
+        bool dirty{false};
+        QEntry entry;
+    };
+
+    struct Bucket
+    {
+        int state{-1};
+        Record record;
+    };
+
+    std::vector<Bucket> buckets;
+    std::size_t count{0};
+    int bucketShift{32};
+    std::vector<Slot> cache;
+    int cacheShift{32};
+
+    std::size_t maxStates{0};
+    EvictionPolicy eviction;
+    std::function<void(int state, const QEntry& entry)> evictionHandler;
+    std::function<bool(int state, QEntry& entry)> missHandler;
+    std::uint32_t clock{0};
+
+    long hits{0};
+    long misses{0};
+    long evictions{0};
+
+public:
+    // Constructs a table with the given cache and budget settings.
+    explicit QTable(const LearnerConfig& config);
+
+    // Returns the entry for the given state without inserting it. Unknown
+    // states read a shared all-zero entry. The reference is only valid until
+    // the next call to a non-const method.
+    const QEntry& find(int state);
+
+    // Returns the entry for the given state so that it can be modified,
+    // inserting it if needed.
+    QEntry& get(int state);
+
+    // Starts loading the cache slot and the home bucket of the given state, so
+    // that a later lookup of the state doesn't wait for memory.
+    void prefetch(int state);
+
+    // Writes the modified cache entries back to the main table.
+    void flush();
+
+    // Calls the given function for each entry in order of state after writing
+    // back the cache.
+    void forEach(const std::function<void(int state, const QEntry& entry)>& f);
+
+    // Removes the entries that only contain zeros. Returns the number of
+    // entries removed.
+    int compact();
+
+    // Sets a function that is called for every entry before it is evicted.
+    void setEvictionHandler(
+        std::function<void(int state, const QEntry& entry)> handler);
+
+    // Sets a function that is called when a state is not in the table. If the
+    // function fills in the entry and returns true, the entry is inserted for
+    // the state instead of treating the state as unknown.
+    void setMissHandler(std::function<bool(int state, QEntry& entry)> handler);
+
+    // Returns the number of entries in the table.
+    std::size_t size();
+
+    // Returns an estimate of the memory used by the table, in bytes.
+    std::size_t getMemoryUsage();
+
+    // Returns the fraction of lookups that hit the cache since the last reset.
+    float getCacheHitRate();
+
+    // Returns the number of entries evicted since the last reset.
+    long getEvictionCount();
+
+    // Resets the cache and eviction statistics.
+    void resetStatistics();
+
+    // Returns an estimate of the memory used by each entry of the main table,
+    // in bytes.
+    static std::size_t getEntryMemoryUsage();
+
+private:
+    // Returns the cache slot that the given state maps to.
+    Slot& getSlot(int state);
+
+    // Tries to find the given state in the cache, promoting it if it is
+    // accessed more often than the current occupant of its slot. Returns
+    // nullptr if the state is not cached after the access.
+    Slot* access(int state);
+
+    // Returns the first bucket probed for the given state.
+    std::size_t getHomeBucket(int state) const;
+
+    // Returns the index of the bucket that holds the given state, or -1 if the
+    // state is not in the main table.
+    long findBucket(int state) const;
+
+    // Removes the entry in the given bucket, shifting back the entries that
+    // follow it in the probe sequence so that no tombstones are needed.
+    void erase(std::size_t bucket);
+
+    // Moves the entries into a new array of buckets of the given size, which
+    // must be a power of two.
+    void rehash(std::size_t size);
+
+    // Writes the cache slot back to the main table if it was modified.
+    void writeBack(Slot& slot);
+
+    // Returns the bucket of the given state in the main table, asking the miss
+    // handler for its entry if it is not there. Returns -1 if the state is
+    // unknown.
+    long load(int state);
+
+    // Returns the record for the given state in the main table, inserting it
+    // if needed and evicting other states if the table is over its budget.
+    Record& insert(int state);
+
+    // Inserts the given state, which must not be in the main table, with an
+    // empty record, evicting other states if the table is over its budget.
+    // Returns the bucket of the state.
+    std::size_t insertNew(int state);
+
+    // Evicts the coldest states, other than the ones in the cache and the
+    // given state, until the table is comfortably within its budget.
+    void evict(int keep);
+};
+}
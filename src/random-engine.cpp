@@ -0,0 +1,44 @@
+#include "random-engine.h"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace Qbert {
+
+RandomEngine& getRandomEngine()
+{
+    thread_local RandomEngine engine;
+    return engine;
+}
+
+void seedRandomEngine(unsigned seed)
+{
+    getRandomEngine().seed(seed);
+}
+
+int getRandomInt(int n)
+{
+    return std::uniform_int_distribution<int>{0, n - 1}(getRandomEngine());
+}
+
+float getRandomFloat()
+{
+    return std::uniform_real_distribution<float>{0, 1}(getRandomEngine());
+}
+
+std::string saveRandomEngine()
+{
+    std::ostringstream os;
+    os << getRandomEngine();
+    return os.str();
+}
+
+void loadRandomEngine(const std::string& state)
+{
+    std::istringstream is{state};
+    RandomEngine engine;
+    if (!(is >> engine))
+        throw std::runtime_error{"invalid random engine state"};
+    getRandomEngine() = engine;
+}
+}
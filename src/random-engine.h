@@ -0,0 +1,30 @@
+#pragma once
+
+#include <random>
+#include <string>
+
+namespace Qbert {
+
+// The random number engine used by the learners. Each thread has its own
+// engine, so that the random streams of concurrent games stay independent and
+// reproducible.
+using RandomEngine = std::mt19937;
+
+// Returns the random number engine of the current thread.
+RandomEngine& getRandomEngine();
+
+// Seeds the random number engine of the current thread.
+void seedRandomEngine(unsigned seed);
+
+// Returns a random integer in [0, n).
+int getRandomInt(int n);
+
+// Returns a random float in [0, 1).
+float getRandomFloat();
+
+// Returns the state of the random number engine of the current thread.
+std::string saveRandomEngine();
+
+// Restores the state of the random number engine of the current thread.
+void loadRandomEngine(const std::string& state);
+}
@@ -0,0 +1,60 @@
+#include "score-statistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Qbert {
+
+void ScoreStatistics::add(float score, int level)
+{
+    ++count;
+    double delta = score - mean;
+    mean += delta / count;
+    squaredDeviations += delta * (score - mean);
+    ++histogram[score];
+    maxLevel = std::max(maxLevel, level);
+}
+
+long ScoreStatistics::getCount() const
+{
+    return count;
+}
+
+double ScoreStatistics::getMean() const
+{
+    return mean;
+}
+
+double ScoreStatistics::getStandardDeviation() const
+{
+    return count < 2 ? 0 : std::sqrt(squaredDeviations / (count - 1));
+}
+
+float ScoreStatistics::getQuantile(double quantile) const
+{
+    long rank = std::max(1L, static_cast<long>(std::ceil(quantile * count)));
+    long seen = 0;
+    for (const auto& p : histogram)
+    {
+        seen += p.second;
+        if (seen >= rank)
+            return p.first;
+    }
+    return 0;
+}
+
+float ScoreStatistics::getMin() const
+{
+    return histogram.empty() ? 0 : histogram.begin()->first;
+}
+
+float ScoreStatistics::getMax() const
+{
+    return histogram.empty() ? 0 : histogram.rbegin()->first;
+}
+
+int ScoreStatistics::getMaxLevel() const
+{
+    return maxLevel;
+}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <map>
+
+namespace Qbert {
+
+// Statistics of a stream of episode scores, updated one episode at a time.
+// The mean and variance are kept with Welford's algorithm. The scores of the
+// game are multiples of 25, so the quantiles are read from an exact histogram
+// that stays small.
+class ScoreStatistics
+{
+    long count{0};
+    double mean{0};
+    double squaredDeviations{0};
+    std::map<float, long> histogram;
+    int maxLevel{-1};
+
+public:
+    // Adds an episode with the given score that reached the given level.
+    void add(float score, int level);
+
+    // Returns the number of episodes.
+    long getCount() const;
+
+    // Returns the mean score.
+    double getMean() const;
+
+    // Returns the sample standard deviation of the scores.
+    double getStandardDeviation() const;
+
+    // Returns the score at the given quantile, between 0 and 1, using the
+    // nearest rank.
+    float getQuantile(double quantile) const;
+
+    // Returns the lowest score.
+    float getMin() const;
+
+    // Returns the highest score.
+    float getMax() const;
+
+    // Returns the highest level reached, starting at 0.
+    int getMaxLevel() const;
+};
+}
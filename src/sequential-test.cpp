@@ -0,0 +1,75 @@
+#include "sequential-test.h"
+
+#include <cmath>
+#include <limits>
+
+namespace Qbert {
+
+constexpr long SequentialTest::minPairs;
+constexpr double SequentialTest::mixingScale;
+
+SequentialTest::SequentialTest(double significance)
+    : significance{significance}
+{
+}
+
+void SequentialTest::add(double difference)
+{
+    ++count;
+    double delta = difference - mean;
+    mean += delta / count;
+    squaredDeviations += delta * (difference - mean);
+}
+
+bool SequentialTest::isSignificant() const
+{
+    return count >= minPairs &&
+        getLogLikelihoodRatio() >= std::log(1 / significance);
+}
+
+long SequentialTest::getCount() const
+{
+    return count;
+}
+
+double SequentialTest::getMean() const
+{
+    return mean;
+}
+
+double SequentialTest::getConfidenceRadius() const
+{
+    if (count < 2)
+        return std::numeric_limits<double>::infinity();
+    // The radius is where the likelihood ratio reaches 1 / significance. The
+    // ratio is bounded, so it may not be reachable yet.
+    double degrees = count - 1.0;
+    double spread = 1 + count * mixingScale * mixingScale;
+    double ratio = std::exp(
+        (std::log(1 / significance) + 0.5 * std::log(spread)) * 2 /
+        (degrees + 1));
+    if (ratio >= spread)
+        return std::numeric_limits<double>::infinity();
+    double t2 = degrees * (ratio - 1) / (1 - ratio / spread);
+    double variance = squaredDeviations / degrees;
+    return std::sqrt(variance * t2 / count);
+}
+
+double SequentialTest::getLogLikelihoodRatio() const
+{
+    if (count < 2)
+        return 0;
+    double degrees = count - 1.0;
+    double spread = 1 + count * mixingScale * mixingScale;
+    double logSpread = std::log(spread);
+    double variance = squaredDeviations / degrees;
+    // Equal differences have an infinite t statistic, where the ratio reaches
+    // its bound.
+    if (variance == 0)
+        return mean == 0 ? -0.5 * logSpread : 0.5 * degrees * logSpread;
+    double t2 = count * mean * mean / variance;
+    return -0.5 * logSpread +
+        0.5 * (degrees + 1) *
+        (std::log1p(t2 / degrees) - std::log1p(t2 / (degrees * spread)));
+}
+}
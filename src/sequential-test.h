@@ -0,0 +1,53 @@
+#pragma once
+
+namespace Qbert {
+
+// A sequential test of whether the mean of a stream of paired differences is
+// zero, which can be checked after every pair without inflating the false
+// positive rate. This is the mixture sequential probability ratio test, with
+// a normal mixture over the effect sizes relative to the unknown standard
+// deviation. The likelihood ratio is the one of the t statistic, which doesn't
+// depend on the variance, so estimating it doesn't inflate the false positive
+// rate, and equal differences give strong but finite evidence.
+class SequentialTest
+{
+    const double significance;
+    long count{0};
+    double mean{0};
+    double squaredDeviations{0};
+
+public:
+    // The number of pairs before the test starts to decide, so that the
+    // variance estimate has settled.
+    static constexpr long minPairs = 10;
+
+    // The standard deviation of the mixture over the effect sizes, relative
+    // to the standard deviation of the differences. Smaller values detect
+    // small effects sooner and large ones later.
+    static constexpr double mixingScale = 0.5;
+
+    // Constructs a test with the given false positive rate.
+    explicit SequentialTest(double significance);
+
+    // Adds a paired difference.
+    void add(double difference);
+
+    // Returns true once the mean of the differences is significantly
+    // different from zero.
+    bool isSignificant() const;
+
+    // Returns the number of differences.
+    long getCount() const;
+
+    // Returns the mean of the differences.
+    double getMean() const;
+
+    // Returns the radius of the confidence interval around the mean, which
+    // holds at every count at once.
+    double getConfidenceRadius() const;
+
+private:
+    // Returns the logarithm of the mixture likelihood ratio.
+    double getLogLikelihoodRatio() const;
+};
+}
@@ -0,0 +1,126 @@
+#include "shard-coordinator.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <stdexcept>
+#include <iostream>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <ale/ale_interface.hpp>
+
+#include "agent-factory.h"
+#include "child-process.h"
+#include "shared-q-table.h"
+
+namespace Qbert {
+
+static volatile std::sig_atomic_t isStopRequested = 0;
+
+static void requestStop(int /*signal*/)
+{
+    isStopRequested = 1;
+}
+
+// Starts the worker with the given index in a new process, after the given
+// number of restarts. Returns its id. Each restart gets seeds of its own, after
+// the ones of all the workers before it, so that it doesn't replay the random
+// stream it crashed on, and writes its own results.
+static pid_t startWorker(
+    const Args& args,
+    int index,
+    int restarts,
+    const std::function<void(const Args&)>& runWorker)
+{
+    auto workerArgs = args;
+    workerArgs.mode = "learn";
+    workerArgs.workers = 0;
+    workerArgs.randomSeed = args.randomSeed +
+        (restarts * args.workers + index) * args.threads * args.envs;
+    workerArgs.displayScreen = false;
+    validateArgs(workerArgs);
+    return runInChild("worker " + std::to_string(index), [&]() {
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        runWorker(workerArgs);
+    });
+}
+
+void coordinate(
+    const Args& args, const std::function<void(const Args&)>& runWorker)
+{
+    // Creating an agent asks for all of its learners' tables, which creates
+    // their files. The agent never plays, so its ALE doesn't need a ROM.
+    SharedTables tables{args.learnerConfig, args.tableDirectory, true};
+    {
+        auto tableArgs = args;
+        tableArgs.learnerConfig.sharedTables = &tables;
+        ALEInterface ale;
+        createAgent(ale, tableArgs);
+    }
+
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+
+    std::vector<pid_t> workers(args.workers);
+    std::vector<int> restarts(args.workers);
+    for (int i = 0; i < args.workers; ++i)
+        workers[i] = startWorker(args, i, 0, runWorker);
+    std::cout << "Started " << args.workers << " workers sharing tables in "
+              << args.tableDirectory << "." << std::endl;
+
+    auto lastCheckpoint = std::chrono::steady_clock::now();
+    int running = args.workers;
+    while (!isStopRequested && running > 0)
+    {
+        sleep(1);
+
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+        {
+            int index = 0;
+            while (index < args.workers && workers[index] != pid)
+                ++index;
+            if (index == args.workers)
+                continue;
+            if (WIFSIGNALED(status) && !isStopRequested)
+            {
+                std::cout << "Worker " << index << " crashed with signal "
+                          << WTERMSIG(status) << ", restarting it."
+                          << std::endl;
+                workers[index] =
+                    startWorker(args, index, ++restarts[index], runWorker);
+            }
+            else
+            {
+                std::cout << "Worker " << index << " exited." << std::endl;
+                workers[index] = 0;
+                --running;
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        auto interval = std::chrono::seconds{args.checkpointSeconds};
+        if (now - lastCheckpoint >= interval)
+        {
+            tables.save();
+            lastCheckpoint = now;
+        }
+    }
+
+    for (auto pid : workers)
+        if (pid > 0)
+            kill(pid, SIGTERM);
+    for (auto pid : workers)
+        if (pid > 0)
+            waitpid(pid, nullptr, 0);
+    tables.save();
+    tables.removeFiles();
+    std::cout << "Saved the tables and stopped the workers." << std::endl;
+}
+}
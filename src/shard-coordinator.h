@@ -0,0 +1,21 @@
+#pragma once
+
+#include <functional>
+
+#include "args.h"
+
+namespace Qbert {
+
+// Runs the learner given by the arguments in args.workers processes that share
+// its tables through files in args.tableDirectory. The coordinator creates the
+// tables from the param files, starts each worker by calling runWorker in a
+// forked process with the table directory and a seed of its own, and saves the
+// tables to the param files every args.checkpointSeconds seconds.
+//
+// A worker that crashes is restarted with new seeds, and a worker that exits
+// with an error is not. On SIGINT or SIGTERM, or once all the workers have
+// exited, the coordinator stops the workers, saves the tables one last time,
+// and removes their files.
+void coordinate(
+    const Args& args, const std::function<void(const Args&)>& runWorker);
+}
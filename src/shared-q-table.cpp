@@ -0,0 +1,370 @@
+#include "shared-q-table.h"
+
+#include <algorithm>
+#include <vector>
+#include <stdexcept>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "param-file.h"
+
+namespace Qbert {
+
+// The number of states held by a shared table without a budget.
+static constexpr int defaultMaxStates = 1 << 18;
+
+// The number of locks used for striped synchronization.
+static constexpr int stripeCount = 1024;
+
+// The visit counts saturate here, in the same way as in the learner.
+static constexpr int maxVisited = 999999999;
+
+static constexpr int emptyState = -1;
+
+static constexpr std::uint32_t tableMagic = 0x51425354; // "QBST"
+static constexpr std::uint32_t tableVersion = 1;
+
+// The slots start on their own cache line after the header.
+static constexpr std::size_t slotOffset = 64;
+
+// Returns the number of slots for the given number of states. We keep the load
+// factor under 3/4 to keep the probe sequences short.
+static int getCapacity(int maxStates)
+{
+    int capacity = 1;
+    while (capacity < maxStates / 3 * 4 + 4)
+        capacity *= 2;
+    return capacity;
+}
+
+// Maps memory for a table with the given number of bytes, shared through the
+// given file, or private if there is no file.
+static void* mapTable(int fd, std::size_t length)
+{
+    int flags = fd < 0 ? MAP_PRIVATE | MAP_ANONYMOUS : MAP_SHARED;
+    void* memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (memory == MAP_FAILED)
+        throw std::runtime_error{"cannot map shared table"};
+    return memory;
+}
+
+SharedQTable::SharedQTable(int maxStates, TableSync sync) : sync{sync}
+{
+    if (maxStates <= 0)
+        maxStates = defaultMaxStates;
+    int capacity = getCapacity(maxStates);
+    length = slotOffset + capacity * sizeof(Slot);
+    memory = mapTable(-1, length);
+    header = static_cast<Header*>(memory);
+    if (sync == TableSync::Striped)
+        stripes.reset(new std::mutex[stripeCount]);
+    initialize(capacity, maxStates);
+}
+
+SharedQTable::SharedQTable(void* memory, std::size_t length, TableSync sync)
+    : memory{memory},
+      length{length},
+      header{static_cast<Header*>(memory)},
+      sync{sync}
+{
+    static_assert(sizeof(Header) <= slotOffset, "the header is too large");
+    if (sync == TableSync::Striped)
+        stripes.reset(new std::mutex[stripeCount]);
+}
+
+SharedQTable::~SharedQTable()
+{
+    munmap(memory, length);
+}
+
+std::unique_ptr<SharedQTable> SharedQTable::create(
+    const std::string& path, int maxStates, const ParamTable& entries)
+{
+    if (maxStates <= 0)
+        maxStates = defaultMaxStates;
+    int capacity = getCapacity(maxStates);
+    std::size_t length = slotOffset + capacity * sizeof(Slot);
+    auto temp = path + ".temp";
+    int fd = ::open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::runtime_error{"cannot create shared table " + path};
+    if (ftruncate(fd, length) != 0)
+    {
+        close(fd);
+        throw std::runtime_error{"cannot create shared table " + path};
+    }
+    auto memory = mapTable(fd, length);
+    close(fd);
+    std::unique_ptr<SharedQTable> table{
+        new SharedQTable{memory, length, TableSync::Atomic}};
+    table->initialize(capacity, maxStates);
+    for (const auto& p : entries)
+        table->set(p.first, p.second);
+    if (rename(temp.c_str(), path.c_str()) != 0)
+        throw std::runtime_error{"cannot create shared table " + path};
+    return table;
+}
+
+std::unique_ptr<SharedQTable> SharedQTable::open(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDWR);
+    if (fd < 0)
+        throw std::runtime_error{"cannot open shared table " + path};
+    struct stat info;
+    if (fstat(fd, &info) < 0 ||
+        static_cast<std::size_t>(info.st_size) < slotOffset)
+    {
+        close(fd);
+        throw std::runtime_error{"invalid shared table " + path};
+    }
+    std::size_t length = info.st_size;
+    auto memory = mapTable(fd, length);
+    close(fd);
+    std::unique_ptr<SharedQTable> table{
+        new SharedQTable{memory, length, TableSync::Atomic}};
+    auto header = table->header;
+    if (header->magic != tableMagic || header->version != tableVersion ||
+        header->capacity <= 0 ||
+        (header->capacity & (header->capacity - 1)) != 0 ||
+        length < slotOffset + header->capacity * sizeof(Slot))
+        throw std::runtime_error{"invalid shared table " + path};
+    table->attach();
+    return table;
+}
+
+void SharedQTable::initialize(int capacity, int maxStates)
+{
+    header->magic = tableMagic;
+    header->version = tableVersion;
+    header->capacity = capacity;
+    header->maxStates = maxStates;
+    header->count.store(0, std::memory_order_relaxed);
+    header->droppedUpdates.store(0, std::memory_order_relaxed);
+    attach();
+    for (int i = 0; i < capacity; ++i)
+        slots[i].state.store(emptyState, std::memory_order_relaxed);
+}
+
+void SharedQTable::attach()
+{
+    slots = reinterpret_cast<Slot*>(static_cast<char*>(memory) + slotOffset);
+    mask = header->capacity - 1;
+}
+
+const QEntry& SharedQTable::find(int state, QEntry& buffer)
+{
+    static const QEntry empty{};
+    int slot = getSlot(state, false);
+    if (slot == -1)
+        return empty;
+    if (sync == TableSync::Atomic)
+        return slots[slot].entry;
+    std::lock_guard<std::mutex> lock{getStripe(slot)};
+    buffer = slots[slot].entry;
+    return buffer;
+}
+
+void SharedQTable::prefetch(int state) const
+{
+    // A slot can straddle two cache lines, so both of its ends are prefetched.
+    const auto* slot = &slots[getHomeSlot(state)];
+    __builtin_prefetch(slot);
+    __builtin_prefetch(reinterpret_cast<const char*>(slot + 1) - 1);
+}
+
+void SharedQTable::addUtility(int state, int actionIndex, float delta)
+{
+    int slot = getSlot(state, true);
+    if (slot == -1)
+    {
+        header->droppedUpdates.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    auto& utility = slots[slot].entry.utilities[actionIndex];
+    if (sync == TableSync::Striped)
+    {
+        std::lock_guard<std::mutex> lock{getStripe(slot)};
+        utility += delta;
+        return;
+    }
+    float expected, desired;
+    __atomic_load(&utility, &expected, __ATOMIC_RELAXED);
+    do
+    {
+        desired = expected + delta;
+    } while (!__atomic_compare_exchange(
+        &utility,
+        &expected,
+        &desired,
+        true,
+        __ATOMIC_RELAXED,
+        __ATOMIC_RELAXED));
+}
+
+void SharedQTable::addVisit(int state, int actionIndex)
+{
+    int slot = getSlot(state, true);
+    if (slot == -1)
+    {
+        header->droppedUpdates.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    auto& visited = slots[slot].entry.visited[actionIndex];
+    if (sync == TableSync::Striped)
+    {
+        std::lock_guard<std::mutex> lock{getStripe(slot)};
+        visited = std::min(visited + 1, maxVisited);
+        return;
+    }
+    if (__atomic_add_fetch(&visited, 1, __ATOMIC_RELAXED) > maxVisited)
+        __atomic_sub_fetch(&visited, 1, __ATOMIC_RELAXED); // Avoids overflow.
+}
+
+void SharedQTable::set(int state, const QEntry& entry)
+{
+    int slot = getSlot(state, true);
+    if (slot == -1)
+        header->droppedUpdates.fetch_add(1, std::memory_order_relaxed);
+    else
+        slots[slot].entry = entry;
+}
+
+void SharedQTable::forEach(
+    const std::function<void(int state, const QEntry& entry)>& f)
+{
+    std::vector<int> indices;
+    for (int i = 0; i <= mask; ++i)
+        if (slots[i].state.load(std::memory_order_acquire) != emptyState)
+            indices.push_back(i);
+    std::sort(indices.begin(), indices.end(), [this](int lhs, int rhs) {
+        return slots[lhs].state.load(std::memory_order_relaxed) <
+            slots[rhs].state.load(std::memory_order_relaxed);
+    });
+    QEntry buffer;
+    for (int i : indices)
+    {
+        int state = slots[i].state.load(std::memory_order_relaxed);
+        f(state, find(state, buffer));
+    }
+}
+
+int SharedQTable::size() const
+{
+    return header->count.load(std::memory_order_relaxed);
+}
+
+std::size_t SharedQTable::getMemoryUsage() const
+{
+    return sizeof(*this) + length +
+        (stripes ? stripeCount * sizeof(std::mutex) : 0);
+}
+
+long SharedQTable::getDroppedUpdates() const
+{
+    return header->droppedUpdates.load(std::memory_order_relaxed);
+}
+
+int SharedQTable::getHomeSlot(int state) const
+{
+    // This is the same Fibonacci hash used for the cache of the local tables.
+    return (static_cast<std::uint32_t>(state) * 2654435769u) & mask;
+}
+
+int SharedQTable::getSlot(int state, bool insert)
+{
+    int slot = getHomeSlot(state);
+    for (int probe = 0; probe <= mask; ++probe, slot = (slot + 1) & mask)
+    {
+        int current = slots[slot].state.load(std::memory_order_acquire);
+        if (current == state)
+            return slot;
+        if (current != emptyState)
+            continue;
+        if (!insert ||
+            header->count.load(std::memory_order_relaxed) >= header->maxStates)
+            return -1;
+        // If another thread claims the slot first, we keep probing unless it
+        // claimed it for the same state.
+        if (slots[slot].state.compare_exchange_strong(
+                current, state, std::memory_order_acq_rel))
+        {
+            header->count.fetch_add(1, std::memory_order_relaxed);
+            return slot;
+        }
+        if (current == state)
+            return slot;
+    }
+    return -1;
+}
+
+std::mutex& SharedQTable::getStripe(int slot) const
+{
+    return stripes[slot & (stripeCount - 1)];
+}
+
+SharedTables::SharedTables(
+    const LearnerConfig& config, const std::string& directory, bool isOwner)
+    : maxStates{config.maxStates},
+      sync{config.tableSync},
+      directory{directory},
+      isOwner{isOwner}
+{
+}
+
+std::shared_ptr<SharedQTable> SharedTables::get(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    auto& table = tables[name];
+    if (table)
+        return table;
+    if (directory.empty())
+    {
+        table = std::make_shared<SharedQTable>(maxStates, sync);
+        for (const auto& p : readParamFile(name))
+            table->set(p.first, p.second);
+    }
+    else if (isOwner)
+    {
+        table = SharedQTable::create(
+            getPath(name), maxStates, readParamFile(name));
+    }
+    else
+    {
+        table = SharedQTable::open(getPath(name));
+    }
+    return table;
+}
+
+void SharedTables::save()
+{
+    if (!isOwner)
+        return;
+    std::lock_guard<std::mutex> lock{mutex};
+    for (const auto& p : tables)
+    {
+        ParamTable table;
+        p.second->forEach([&](int state, const QEntry& entry) {
+            table[state] = entry;
+        });
+        writeParamFile(p.first, table);
+    }
+}
+
+void SharedTables::removeFiles()
+{
+    if (directory.empty() || !isOwner)
+        return;
+    std::lock_guard<std::mutex> lock{mutex};
+    for (const auto& p : tables)
+        remove(getPath(p.first).c_str());
+}
+
+std::string SharedTables::getPath(const std::string& name) const
+{
+    return directory + "/qbert-" + name + ".table";
+}
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <functional>
+
+#include "learner-config.h"
+#include "param-file.h"
+#include "q-table.h"
+
+namespace Qbert {
+
+// A table of Q-learning entries that can be read and updated by several
+// threads at once. The table has a fixed capacity, so that entries never move,
+// and uses open addressing with the states claimed by compare-and-swap. Once
+// the table is full, updates to new states are dropped.
+//
+// With atomic synchronization, the writes are lock-free atomic additions and
+// the reads are not synchronized at all, so that a row can be read while
+// another thread is updating it, as in Hogwild. With striped synchronization,
+// the reads and writes of a row are done under one of a fixed set of locks,
+// so that rows are always read whole.
+//
+// The table can also be placed in a memory-mapped file and shared between
+// processes. Such tables always use atomic synchronization, since a process
+// that crashes while holding a lock would block the others, while a process
+// that crashes in the middle of an atomic update leaves the table valid.
+class SharedQTable
+{
+    struct Header
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::int32_t capacity;
+        std::int32_t maxStates;
+        std::atomic<int> count;
+        std::atomic<long> droppedUpdates;
+    };
+
+    struct Slot
+    {
+        std::atomic<int> state;
+        QEntry entry;
+    };
+
+    void* memory{nullptr};
+    std::size_t length{0};
+    Header* header{nullptr};
+    Slot* slots{nullptr};
+    int mask{0};
+
+    const TableSync sync;
+    std::unique_ptr<std::mutex[]> stripes;
+
+public:
+    // Constructs a table in private memory that holds up to the given number
+    // of states.
+    SharedQTable(int maxStates, TableSync sync);
+
+    SharedQTable(const SharedQTable&) = delete;
+    SharedQTable& operator=(const SharedQTable&) = delete;
+
+    ~SharedQTable();
+
+    // Creates a table that holds up to the given number of states in the file
+    // at the given path, and fills it with the given entries. The file only
+    // appears once it is complete, so that other processes never open a
+    // partial table.
+    static std::unique_ptr<SharedQTable> create(
+        const std::string& path, int maxStates, const ParamTable& entries);
+
+    // Maps the table in the file at the given path, which was created by
+    // another process.
+    static std::unique_ptr<SharedQTable> open(const std::string& path);
+
+    // Returns the entry for the given state, or the all-zero entry for unknown
+    // states. The entry is copied to the given buffer if that is needed to
+    // read it safely, so the result is only valid as long as the buffer is.
+    const QEntry& find(int state, QEntry& buffer);
+
+    // Starts loading the first slot probed for the given state, so that a
+    // later lookup of the state doesn't wait for memory.
+    void prefetch(int state) const;
+
+    // Adds the given delta to the utility of the given action.
+    void addUtility(int state, int actionIndex, float delta);
+
+    // Adds a visit to the given action, saturating at the maximum count.
+    void addVisit(int state, int actionIndex);
+
+    // Replaces the entry for the given state. This is not synchronized with
+    // the other methods, and is meant for loading the table.
+    void set(int state, const QEntry& entry);
+
+    // Calls the given function for each entry in order of state.
+    void forEach(const std::function<void(int state, const QEntry& entry)>& f);
+
+    // Returns the number of states in the table.
+    int size() const;
+
+    // Returns the memory used by the table, in bytes.
+    std::size_t getMemoryUsage() const;
+
+    // Returns the number of updates dropped because the table was full.
+    long getDroppedUpdates() const;
+
+private:
+    // Wraps the given memory, which holds a table if the header is set.
+    SharedQTable(void* memory, std::size_t length, TableSync sync);
+
+    // Writes the header and marks all the slots as empty.
+    void initialize(int capacity, int maxStates);
+
+    // Sets the slots and mask from the header.
+    void attach();
+
+    // Returns the first slot probed for the given state.
+    int getHomeSlot(int state) const;
+
+    // Returns the slot index for the given state, inserting it if needed.
+    // Returns -1 if the state is not in the table and can't be inserted.
+    int getSlot(int state, bool insert);
+
+    // Returns the lock for the given slot.
+    std::mutex& getStripe(int slot) const;
+};
+
+// The tables shared by the learners of all the threads, indexed by name. Each
+// table is loaded from its param file the first time a learner asks for it.
+//
+// The tables can also be shared with other processes through files in a given
+// directory, such as /dev/shm. The process that owns the files creates them
+// from the param files, and is the only one that saves them back.
+class SharedTables
+{
+    const int maxStates;
+    const TableSync sync;
+    const std::string directory;
+    const bool isOwner;
+
+    std::mutex mutex;
+    std::map<std::string, std::shared_ptr<SharedQTable>> tables;
+
+public:
+    // Constructs the shared tables with the given settings. If a directory is
+    // given, the tables are placed in files in it, which are created if this
+    // is the owner and opened otherwise.
+    explicit SharedTables(
+        const LearnerConfig& config,
+        const std::string& directory = "",
+        bool isOwner = true);
+
+    // Returns the table with the given name, loading it if needed.
+    std::shared_ptr<SharedQTable> get(const std::string& name);
+
+    // Saves all the tables to their param files, unless they are owned by
+    // another process. This can be called while the tables are being updated,
+    // in which case the saved rows may mix values from before and after a
+    // concurrent update.
+    void save();
+
+    // Removes the files of the tables owned by this process.
+    void removeFiles();
+
+private:
+    // Returns the path of the file for the table with the given name.
+    std::string getPath(const std::string& name) const;
+};
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+namespace Qbert {
+
+// A bounded lock-free queue for a single producer thread and a single consumer
+// thread. The capacity is rounded up to a power of two.
+template <typename T>
+class SpscQueue
+{
+    std::vector<T> buffer;
+    std::size_t mask;
+
+    // The indices are padded to separate cache lines, so that the producer and
+    // the consumer don't invalidate each other's line on every operation.
+    char padding0[64];
+    std::atomic<std::size_t> head{0};
+    char padding1[64 - sizeof(std::atomic<std::size_t>)];
+    std::atomic<std::size_t> tail{0};
+    char padding2[64 - sizeof(std::atomic<std::size_t>)];
+
+public:
+    explicit SpscQueue(std::size_t capacity)
+    {
+        std::size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+        buffer.resize(size);
+        mask = size - 1;
+    }
+
+    // Adds an item to the queue. Returns false if the queue is full. This
+    // should only be called by the producer.
+    bool push(const T& item)
+    {
+        auto index = tail.load(std::memory_order_relaxed);
+        if (index - head.load(std::memory_order_acquire) == buffer.size())
+            return false;
+        buffer[index & mask] = item;
+        tail.store(index + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Removes an item from the queue. Returns false if the queue is empty. This
+    // should only be called by the consumer.
+    bool pop(T& item)
+    {
+        auto index = head.load(std::memory_order_relaxed);
+        if (index == tail.load(std::memory_order_acquire))
+            return false;
+        item = buffer[index & mask];
+        head.store(index + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns the number of items in the queue. This is only approximate while
+    // the other thread is using the queue.
+    std::size_t size() const
+    {
+        return tail.load(std::memory_order_relaxed) -
+            head.load(std::memory_order_relaxed);
+    }
+};
+}
@@ -1,18 +1,24 @@
 #include "subsumption-agent-2.h"
 
+#include <chrono>
+
 namespace Qbert {
 
 SubsumptionAgent2::SubsumptionAgent2(
     ALEInterface& ale,
     const std::string& name,
+    const std::string& blockSolverName,
     StateEncoding encodeBlockState,
     StateEncoding encodeEnemyState,
     SubsumptionSupression suppress,
-    ExplorationPolicy explore)
+    ExplorationPolicy explore,
+    const LearnerConfig& config,
+    std::unique_ptr<LookaheadSearch> lookahead)
     : Agent{ale},
-      blockSolver{name + "-block-solver", encodeBlockState, explore},
-      enemyAvoider{name + "-enemy-avoider", encodeEnemyState, explore},
-      suppress{suppress}
+      blockSolver{blockSolverName, encodeBlockState, explore, config},
+      enemyAvoider{name + "-enemy-avoider", encodeEnemyState, explore, config},
+      suppress{suppress},
+      lookahead{std::move(lookahead)}
 {
 }
 
@@ -22,6 +28,10 @@ void SubsumptionAgent2::resetGame()
     blockSolver.reset();
     enemyAvoider.reset();
     enemyAvoiderActionTaken = false;
+    searches = 0;
+    rollouts = 0;
+    searchSeconds = 0;
+    deathsAvoided = 0;
 }
 
 float SubsumptionAgent2::getRandomFraction()
@@ -33,14 +43,69 @@ float SubsumptionAgent2::getRandomFraction()
     return totalActionCount == 0 ? 0 : randomActionCount / totalActionCount;
 }
 
-void SubsumptionAgent2::update(
+std::vector<std::pair<std::string, float>> SubsumptionAgent2::getStatistics()
+{
+    std::vector<std::pair<std::string, float>> statistics;
+    for (const auto& statistic : blockSolver.getStatistics())
+        statistics.emplace_back(
+            "Block Solver " + statistic.first, statistic.second);
+    for (const auto& statistic : enemyAvoider.getStatistics())
+        statistics.emplace_back(
+            "Enemy Avoider " + statistic.first, statistic.second);
+    if (lookahead)
+    {
+        // The deaths avoided are the difference between the death rates of
+        // the rollouts of the enemy avoider's action and of the chosen one.
+        statistics.emplace_back("Lookahead Searches", searches);
+        statistics.emplace_back(
+            "Lookahead Time (us)",
+            searches == 0 ? 0 : searchSeconds / searches * 1e6);
+        statistics.emplace_back(
+            "Lookahead Rollouts",
+            searches == 0 ? 0 : static_cast<float>(rollouts) / searches);
+        statistics.emplace_back("Lookahead Deaths Avoided", deathsAvoided);
+    }
+    return statistics;
+}
+
+void SubsumptionAgent2::saveTables()
+{
+    blockSolver.saveToFile();
+    enemyAvoider.saveToFile();
+}
+
+void SubsumptionAgent2::saveState(std::ostream& os) const
+{
+    Agent::saveState(os);
+    os << enemyAvoiderActionTaken << std::endl;
+    blockSolver.saveState(os);
+    enemyAvoider.saveState(os);
+}
+
+void SubsumptionAgent2::restoreState(std::istream& is)
+{
+    Agent::restoreState(is);
+    is >> enemyAvoiderActionTaken;
+    blockSolver.restoreState(is);
+    enemyAvoider.restoreState(is);
+}
+
+void SubsumptionAgent2::encode(
     std::pair<int, int> position,
     const StateType& state,
-    const Action& actionPerformed,
-    float reward,
     Color startColor,
     Color goalColor,
     int level)
+{
+    blockState =
+        blockSolver.encode(position, state, startColor, goalColor, level);
+    enemyState =
+        enemyAvoider.encode(position, state, startColor, goalColor, level);
+    mask = Learner::getActionMask(position, state);
+    isSuppressed = suppress(state, position.first, position.second);
+}
+
+void SubsumptionAgent2::update(const Action& actionPerformed, float reward)
 {
     // The reward for a block changing color is +25, and the rewards involving
     // enemies are all multiples of 100, so we can divide the rewards
@@ -48,22 +113,8 @@ void SubsumptionAgent2::update(
     // the rest for the enemy avoider.
     float blockSolverReward = fmod((fmod(reward, 100) + 100), 100);
     float enemyAvoiderReward = reward - blockSolverReward;
-    blockSolver.update(
-        position,
-        state,
-        actionPerformed,
-        blockSolverReward,
-        startColor,
-        goalColor,
-        level);
-    enemyAvoider.update(
-        position,
-        state,
-        actionPerformed,
-        enemyAvoiderReward,
-        startColor,
-        goalColor,
-        level);
+    blockSolver.update(blockState, mask, actionPerformed, blockSolverReward);
+    enemyAvoider.update(enemyState, mask, actionPerformed, enemyAvoiderReward);
     if (enemyAvoiderActionTaken)
         enemyAvoider.notifyActionTaken();
     else
@@ -82,24 +133,76 @@ void SubsumptionAgent2::correctUpdate(float reward)
     enemyAvoider.correctUpdate(enemyAvoiderReward);
 }
 
-Action SubsumptionAgent2::getAction(
-    std::pair<int, int> position,
-    const StateType& state,
-    Color startColor,
-    Color goalColor,
-    int level)
+Action SubsumptionAgent2::getAction()
 {
-    if (suppress(state, position.first, position.second))
+    if (isSuppressed)
     {
         enemyAvoiderActionTaken = true;
-        return enemyAvoider.getAction(
-            position, state, startColor, goalColor, level);
+        auto action = enemyAvoider.getAction(enemyState, mask);
+        // The random actions are left alone, so that the enemy avoider keeps
+        // exploring.
+        if (lookahead && !enemyAvoider.wasRandomAction())
+            action = searchAction(action);
+        return action;
     }
     else
     {
         enemyAvoiderActionTaken = false;
-        return blockSolver.getAction(
-            position, state, startColor, goalColor, level);
+        return blockSolver.getAction(blockState, mask);
+    }
+}
+
+Action SubsumptionAgent2::searchAction(Action action)
+{
+    if (mask == 0)
+        return action;
+
+    auto start = std::chrono::steady_clock::now();
+    auto result = lookahead->search(mask);
+    searchSeconds += std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    ++searches;
+    for (int i = 0; i < 4; ++i)
+        rollouts += result.rollouts[i];
+    for (int i = 0; i < 4; ++i)
+        if ((mask & (1 << i)) != 0 && result.rollouts[i] == 0)
+            return action;
+
+    auto utilities = enemyAvoider.getUtilities(enemyState);
+    int best = -1;
+    for (int i = 0; i < 4; ++i)
+    {
+        if ((mask & (1 << i)) == 0)
+            continue;
+        if (best == -1 ||
+            utilities[i] + result.values[i] >
+                utilities[best] + result.values[best])
+            best = i;
     }
+    deathsAvoided += result.deathRates[Learner::actionToIndex(action)] -
+        result.deathRates[best];
+    return Learner::indexToAction(best);
+}
+
+void SubsumptionAgent2::prefetchRows()
+{
+    // Only one of the learners chooses the action, but both of them update
+    // their tables with the new state.
+    blockSolver.prefetch(blockState);
+    enemyAvoider.prefetch(enemyState);
+}
+
+void SubsumptionAgent2::prefetchSuccessors(
+    std::pair<int, int> position,
+    const StateType& state,
+    Color startColor,
+    Color goalColor,
+    int level)
+{
+    blockSolver.prefetchSuccessors(
+        position, state, startColor, goalColor, level);
+    enemyAvoider.prefetchSuccessors(
+        position, state, startColor, goalColor, level);
 }
 }
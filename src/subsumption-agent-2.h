@@ -1,11 +1,14 @@
 #pragma once
 
+#include <memory>
 #include <string>
 
 #include "agent.h"
 #include "learner.h"
+#include "lookahead-search.h"
 #include "state-encoding.h"
 #include "exploration-policy.h"
+#include "learner-config.h"
 
 namespace Qbert {
 
@@ -20,20 +23,34 @@ class SubsumptionAgent2 : public Agent
 {
     Learner blockSolver;
     Learner enemyAvoider;
+    int blockState{-1}, enemyState{-1};
+    int mask{0};
+    bool isSuppressed{false};
     bool enemyAvoiderActionTaken{false};
     SubsumptionSupression suppress;
 
+    std::unique_ptr<LookaheadSearch> lookahead;
+    int searches{0};
+    long rollouts{0};
+    double searchSeconds{0};
+    float deathsAvoided{0};
+
 public:
     // Contructs an agent with a reference to the current ALE instance, the
-    // given name, the given state encoding functions, the given suppression
-    // function, and the given exploration policy.
+    // given name, the given name for the block solver's table, the given state
+    // encoding functions, the given suppression function, the given
+    // exploration policy, and the given table settings. With a lookahead
+    // search, the enemy avoider's actions are checked by rolling them out.
     SubsumptionAgent2(
         ALEInterface& ale,
         const std::string& name,
+        const std::string& blockSolverName,
         StateEncoding encodeBlockState,
         StateEncoding encodeEnemyState,
         SubsumptionSupression suppress,
-        ExplorationPolicy explore);
+        ExplorationPolicy explore,
+        const LearnerConfig& config,
+        std::unique_ptr<LookaheadSearch> lookahead = nullptr);
 
     virtual ~SubsumptionAgent2() = default;
 
@@ -43,22 +60,52 @@ public:
     // Returns the fraction of random actions taken.
     virtual float getRandomFraction() override;
 
+    // Returns named statistics about the learners for the current game.
+    virtual std::vector<std::pair<std::string, float>> getStatistics()
+        override;
+
+    // Saves the learners' tables without ending the game.
+    virtual void saveTables() override;
+
+    // Writes the state of the current game, apart from the emulator and the
+    // tables, so that the game can be resumed later.
+    virtual void saveState(std::ostream& os) const override;
+
+    // Restores the state of the current game written by saveState.
+    virtual void restoreState(std::istream& is) override;
+
 private:
-    // Assigns the given reward to the learners.
-    virtual void update(
+    // Encodes the given state for the learners. This is done once per
+    // decision, and the other steps of the decision use the encoded states.
+    virtual void encode(
         std::pair<int, int> position,
         const StateType& state,
-        const Action& actionPerformed,
-        float reward,
         Color startColor,
         Color goalColor,
         int level) override;
 
+    // Moves the learners to the encoded state and assigns the given reward to
+    // their last state transition.
+    virtual void update(const Action& actionPerformed, float reward) override;
+
     // Assigns an additional reward to the learners without updating the state.
     virtual void correctUpdate(float reward) override;
 
-    // Gets the best action from the learners.
-    virtual Action getAction(
+    // Gets the best action in the encoded state from the learners.
+    virtual Action getAction() override;
+
+    // Rolls out the valid moves from the current state of the game and
+    // returns the one with the best sum of the enemy avoider's utility and the
+    // mean return of its rollouts. Returns the given action of the enemy
+    // avoider if some move has no rollouts within the budget.
+    Action searchAction(Action action);
+
+    // Prefetches the rows that the learners read for the encoded state.
+    virtual void prefetchRows() override;
+
+    // Prefetches the rows of the states that the moves from the given state
+    // lead to, for the learners that do so.
+    virtual void prefetchSuccessors(
         std::pair<int, int> position,
         const StateType& state,
         Color startColor,
@@ -0,0 +1,473 @@
+#include "sweep.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "child-process.h"
+
+namespace Qbert {
+
+// The factor by which the number of trials is divided, and their frames
+// multiplied, at each round of successive halving.
+static constexpr int reductionFactor = 3;
+
+// A combination of settings trained in a directory of its own.
+struct Trial
+{
+    int id{0};
+    Args args;
+    std::string policy;
+    std::string directory;
+
+    // The last round that the trial took part in, and its frames so far.
+    int round{0};
+    long frames{0};
+
+    // The number of episodes in the trial's results, and the mean score of
+    // the ones from its last round.
+    int episodes{0};
+    double score{0};
+
+    bool failed{false};
+};
+
+// Returns the trials of the sweep given by the arguments.
+static std::vector<Trial> createTrials(const Args& args)
+{
+    auto learners = args.sweepLearners;
+    if (learners.empty())
+        learners.push_back(args.learner);
+    auto policies = args.sweepPolicies;
+    auto alphas = args.sweepAlphas;
+    if (alphas.empty())
+        alphas.push_back(args.learnerConfig.alpha);
+    auto gammas = args.sweepGammas;
+    if (gammas.empty())
+        gammas.push_back(args.learnerConfig.gamma);
+
+    std::vector<Trial> trials;
+    auto addTrial = [&](const std::string& learner,
+                        const std::string& policy,
+                        float alpha,
+                        float gamma,
+                        int seed) {
+        Trial trial;
+        trial.id = static_cast<int>(trials.size());
+        trial.args = args;
+        trial.args.mode = "learn";
+        trial.args.learner = learner;
+        trial.policy = policy.empty() ? args.explorationPolicySpec : policy;
+        if (!policy.empty())
+            trial.args.explorationPolicy = parseExplorationPolicySpec(policy);
+        trial.args.learnerConfig.alpha = alpha;
+        trial.args.learnerConfig.gamma = gamma;
+        trial.args.randomSeed = seed;
+        trial.directory =
+            args.sweepDirectory + "/trial-" + std::to_string(trial.id);
+        trials.push_back(trial);
+    };
+
+    // An empty policy stands for the one given by --exploration_policy.
+    if (policies.empty())
+        policies.push_back("");
+    if (args.sweepSamples == 0)
+    {
+        for (const auto& learner : learners)
+            for (const auto& policy : policies)
+                for (float alpha : alphas)
+                    for (float gamma : gammas)
+                        for (int i = 0; i < args.seeds; ++i)
+                            addTrial(
+                                learner,
+                                policy,
+                                alpha,
+                                gamma,
+                                args.randomSeed + i);
+        return trials;
+    }
+
+    std::mt19937 generator(args.randomSeed);
+    auto pick = [&](const auto& values) {
+        std::uniform_int_distribution<std::size_t> index{0, values.size() - 1};
+        return values[index(generator)];
+    };
+    auto draw = [&](const std::vector<float>& values) {
+        auto range = std::minmax_element(values.begin(), values.end());
+        std::uniform_real_distribution<float> value{*range.first,
+                                                    *range.second};
+        return value(generator);
+    };
+    for (int i = 0; i < args.sweepSamples; ++i)
+    {
+        auto learner = pick(learners);
+        auto policy = pick(policies);
+        float alpha = draw(alphas);
+        float gamma = draw(gammas);
+        std::uniform_int_distribution<int> seed{0, args.seeds - 1};
+        addTrial(
+            learner, policy, alpha, gamma, args.randomSeed + seed(generator));
+    }
+    return trials;
+}
+
+// Trains the given trial for the given number of frames in the current
+// process, which was just forked from the sweep.
+static void runTrialProcess(
+    const Trial& trial,
+    long frames,
+    const std::function<void(const Args&)>& runTrial)
+{
+    // The trial works in its own directory, as if it was the only run.
+    if (chdir(trial.directory.c_str()) != 0)
+        throw std::runtime_error{"cannot enter " + trial.directory};
+    mkdir("params", 0755);
+    mkdir("results", 0755);
+    if (!std::freopen("trial.log", "a", stdout))
+        throw std::runtime_error{"cannot open trial.log"};
+    auto args = trial.args;
+    args.frames = frames;
+    args.resume = trial.round > 0;
+    runTrial(args);
+}
+
+// Reads the scores of the episodes that the given trial finished since the
+// last time, and sets its score to their mean. A trial without new episodes
+// keeps the mean of all its episodes, or 0 if it has none.
+static void readScores(Trial& trial)
+{
+    std::ifstream is{
+        trial.directory + "/results/scores." + trial.args.learner + "." +
+        trial.args.explorationPolicy.first + ".csv"};
+    std::string line;
+    std::getline(is, line);
+    int episode = 0;
+    double total = 0, newTotal = 0;
+    int newEpisodes = 0;
+    while (std::getline(is, line))
+    {
+        std::istringstream fields{line};
+        std::string field;
+        std::getline(fields, field, ',');
+        std::getline(fields, field, ',');
+        double score = std::stod(field);
+        total += score;
+        if (episode >= trial.episodes)
+        {
+            newTotal += score;
+            ++newEpisodes;
+        }
+        ++episode;
+    }
+    trial.episodes = episode;
+    if (newEpisodes > 0)
+        trial.score = newTotal / newEpisodes;
+    else
+        trial.score = episode == 0 ? 0 : total / episode;
+}
+
+// Trains the given trials for the given number of frames each, running up to
+// the given number at once.
+static void runRound(
+    std::vector<Trial*>& trials,
+    long frames,
+    int maxTrials,
+    const std::function<void(const Args&)>& runTrial)
+{
+    std::map<pid_t, Trial*> running;
+    auto collectTrial = [&]() {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0)
+            throw std::runtime_error{"cannot wait for a trial"};
+        auto trial = running.at(pid);
+        running.erase(pid);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            std::cerr << "Error: trial " << trial->id << " failed."
+                      << std::endl;
+            trial->failed = true;
+            return;
+        }
+        trial->frames += frames;
+        readScores(*trial);
+        std::cout << "Trial " << trial->id << ": mean score " << trial->score
+                  << " after " << trial->frames << " frames." << std::endl;
+    };
+
+    for (auto trial : trials)
+    {
+        while (static_cast<int>(running.size()) >= maxTrials)
+            collectTrial();
+        auto pid = runInChild("trial " + std::to_string(trial->id), [&]() {
+            runTrialProcess(*trial, frames, runTrial);
+        });
+        running[pid] = trial;
+    }
+    while (!running.empty())
+        collectTrial();
+}
+
+// Writes the leaderboard of the given trials, ranked by the last round they
+// took part in and then by their score in it, to the given stream.
+static void writeLeaderboard(std::ostream& os, std::vector<Trial> trials)
+{
+    std::stable_sort(
+        trials.begin(), trials.end(), [](const Trial& a, const Trial& b) {
+            if (a.failed != b.failed)
+                return b.failed;
+            if (a.round != b.round)
+                return a.round > b.round;
+            return a.score > b.score;
+        });
+    os << "Rank,Trial,Learner,Policy,Alpha,Gamma,Seed,Rounds,Frames,Score"
+       << std::endl;
+    int rank = 0;
+    for (const auto& trial : trials)
+    {
+        os << ++rank << "," << trial.id << "," << trial.args.learner << ","
+           << trial.policy << "," << trial.args.learnerConfig.alpha << ","
+           << trial.args.learnerConfig.gamma << "," << trial.args.randomSeed
+           << "," << trial.round + 1 << "," << trial.frames << ",";
+        if (trial.failed)
+            os << "failed";
+        else
+            os << trial.score;
+        os << std::endl;
+    }
+}
+
+// Creates the directories of the given trials, which must not exist yet.
+static void createTrialDirectories(const Args& args, std::vector<Trial>& trials)
+{
+    mkdir(args.sweepDirectory.c_str(), 0755);
+    for (const auto& trial : trials)
+    {
+        if (mkdir(trial.directory.c_str(), 0755) != 0)
+            throw std::runtime_error{
+                "cannot create " + trial.directory +
+                (errno == EEXIST ? ", which holds an earlier sweep" : "")};
+    }
+}
+
+// Returns the arguments with the path of the ROM made absolute, since the
+// trials look for it from their own directories.
+static Args getSweepArgs(const Args& args)
+{
+    char rom[PATH_MAX];
+    if (!realpath(args.rom.c_str(), rom))
+        throw std::runtime_error{"cannot find " + args.rom};
+    auto sweepArgs = args;
+    sweepArgs.rom = rom;
+    return sweepArgs;
+}
+
+// Writes the leaderboard of the given trials to the sweep directory and prints
+// it.
+static void saveLeaderboard(const Args& args, const std::vector<Trial>& trials)
+{
+    auto path = args.sweepDirectory + "/leaderboard.csv";
+    std::ofstream os{path};
+    writeLeaderboard(os, trials);
+    std::cout << "Wrote the leaderboard of " << trials.size() << " trials to "
+              << path << "." << std::endl;
+    writeLeaderboard(std::cout, trials);
+}
+
+void sweep(const Args& args, const std::function<void(const Args&)>& runTrial)
+{
+    auto trials = createTrials(getSweepArgs(args));
+    createTrialDirectories(args, trials);
+
+    int maxTrials = getWorkerCount(args.workers);
+    std::vector<Trial*> survivors;
+    for (auto& trial : trials)
+        survivors.push_back(&trial);
+    long frames = args.frames;
+    for (int round = 0;; ++round)
+    {
+        std::cout << "Round " << round + 1 << ": training " << survivors.size()
+                  << (survivors.size() == 1 ? " trial" : " trials") << " for "
+                  << frames << " frames each." << std::endl;
+        for (auto trial : survivors)
+            trial->round = round;
+        runRound(survivors, frames, maxTrials, runTrial);
+
+        survivors.erase(
+            std::remove_if(
+                survivors.begin(),
+                survivors.end(),
+                [](const Trial* trial) { return trial->failed; }),
+            survivors.end());
+        if (survivors.size() <= 1)
+            break;
+        std::stable_sort(
+            survivors.begin(),
+            survivors.end(),
+            [](const Trial* a, const Trial* b) { return a->score > b->score; });
+        survivors.resize(
+            (survivors.size() + reductionFactor - 1) / reductionFactor);
+        frames *= reductionFactor;
+    }
+    saveLeaderboard(args, trials);
+}
+
+// Returns the given exploration policy with its parameter, if it takes one,
+// multiplied by the given factor. A policy given without its parameter starts
+// from the usual one.
+static std::string perturbPolicy(const std::string& spec, float factor)
+{
+    auto colon = spec.find(':');
+    auto name = spec.substr(0, colon);
+    float parameter;
+    if (colon != std::string::npos)
+        parameter = std::stof(spec.substr(colon + 1));
+    else if (name == "epsilon_greedy")
+        parameter = 0.1f;
+    else if (name == "threshold")
+        parameter = 10;
+    else
+        return spec;
+    parameter *= factor;
+    if (name == "threshold")
+        return name + ":" +
+            std::to_string(std::max(1L, std::lround(parameter)));
+    std::ostringstream os;
+    os << name << ":" << std::min(parameter, 1.0f);
+    return os.str();
+}
+
+// Replaces the tables of the given trial by the ones of the donor. The files
+// are linked rather than copied, since a learner always replaces its files
+// when it saves them instead of writing over them.
+static void cloneTables(const Trial& donor, const Trial& trial)
+{
+    auto isTableFile = [](const std::string& file) {
+        for (std::string extension : {".param", ".param.sketch"})
+        {
+            if (file.size() > extension.size() &&
+                file.compare(
+                    file.size() - extension.size(),
+                    extension.size(),
+                    extension) == 0)
+                return true;
+        }
+        return false;
+    };
+    auto listTableFiles = [&](const std::string& directory) {
+        std::vector<std::string> files;
+        auto dir = opendir(directory.c_str());
+        if (dir == nullptr)
+            throw std::runtime_error{"cannot open " + directory};
+        while (auto entry = readdir(dir))
+        {
+            if (isTableFile(entry->d_name))
+                files.push_back(entry->d_name);
+        }
+        closedir(dir);
+        return files;
+    };
+
+    auto from = donor.directory + "/params/";
+    auto to = trial.directory + "/params/";
+    for (const auto& file : listTableFiles(to))
+        unlink((to + file).c_str());
+    for (const auto& file : listTableFiles(from))
+    {
+        if (link((from + file).c_str(), (to + file).c_str()) != 0)
+            throw std::runtime_error{"cannot link " + from + file};
+    }
+}
+
+void trainPopulation(
+    const Args& args, const std::function<void(const Args&)>& runTrial)
+{
+    // The members start from random settings, and each from a seed of its
+    // own.
+    auto populationArgs = getSweepArgs(args);
+    populationArgs.sweepSamples = args.population;
+    auto members = createTrials(populationArgs);
+    for (auto& member : members)
+        member.args.randomSeed = args.randomSeed + member.id;
+    createTrialDirectories(args, members);
+
+    int maxTrials = getWorkerCount(args.workers);
+    std::mt19937 generator(args.randomSeed);
+    std::vector<Trial*> population;
+    for (auto& member : members)
+        population.push_back(&member);
+    for (int generation = 0; generation < args.generations; ++generation)
+    {
+        std::cout << "Generation " << generation + 1 << ": training "
+                  << population.size() << " members for " << args.frames
+                  << " frames each." << std::endl;
+        for (auto member : population)
+            member->round = generation;
+        runRound(population, args.frames, maxTrials, runTrial);
+
+        population.erase(
+            std::remove_if(
+                population.begin(),
+                population.end(),
+                [](const Trial* member) { return member->failed; }),
+            population.end());
+        if (population.size() < 2)
+            break;
+        if (generation + 1 == args.generations)
+            break;
+
+        // The worst quarter of the members exploit the best quarter by taking
+        // over the tables and settings of one of them, and then explore by
+        // perturbing the settings.
+        std::stable_sort(
+            population.begin(),
+            population.end(),
+            [](const Trial* a, const Trial* b) { return a->score > b->score; });
+        int quarter = std::max<int>(population.size() / 4, 1);
+        std::uniform_int_distribution<int> donors{0, quarter - 1};
+        std::bernoulli_distribution isIncreased{0.5};
+        for (auto it = population.end() - quarter; it != population.end();
+             ++it)
+        {
+            auto& member = **it;
+            const auto& donor = *population[donors(generator)];
+            cloneTables(donor, member);
+            auto factor = [&]() {
+                return isIncreased(generator) ? 1.2f : 0.8f;
+            };
+            auto& config = member.args.learnerConfig;
+            config.alpha =
+                std::min(donor.args.learnerConfig.alpha * factor(), 1.0f);
+            config.gamma =
+                std::min(donor.args.learnerConfig.gamma * factor(), 0.999f);
+            member.policy = perturbPolicy(donor.policy, factor());
+            member.args.explorationPolicy = donor.args.explorationPolicy;
+            if (member.policy != donor.policy)
+                member.args.explorationPolicy =
+                    parseExplorationPolicySpec(member.policy);
+            std::cout << "Member " << member.id << " copies member "
+                      << donor.id << ", with alpha " << config.alpha
+                      << ", gamma " << config.gamma << " and policy "
+                      << member.policy << "." << std::endl;
+        }
+    }
+    saveLeaderboard(args, members);
+}
+}
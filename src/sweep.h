@@ -0,0 +1,34 @@
+#pragma once
+
+#include <functional>
+
+#include "args.h"
+
+namespace Qbert {
+
+// Runs a sweep over the learners, exploration policies, learning rates,
+// discount factors and seeds given by the arguments, either over every
+// combination or over args.sweepSamples random ones. Each trial trains by
+// calling runTrial in a forked process with a directory of its own in
+// args.sweepDirectory, which holds its params/ and results/ directories, so
+// that the trials never share tables. Up to args.workers trials run at once,
+// or one per core if it is 0.
+//
+// The emulator frames are allocated by successive halving. Every trial trains
+// for args.frames frames, then the best third of them, by the mean score of
+// the episodes in the last round, resume from their checkpoints for three
+// times as many frames, and so on until a single trial is left. A ranked
+// leaderboard is written to leaderboard.csv in the sweep directory.
+void sweep(const Args& args, const std::function<void(const Args&)>& runTrial);
+
+// Runs population based training with args.population members, whose
+// learning rates, discount factors and exploration policies are drawn as in a
+// random sweep, in the same kind of directories as the trials of a sweep. The
+// members train for args.frames frames in each of args.generations rounds.
+// After each round, each member of the worst quarter by the mean score of the
+// round takes over the tables and settings of a random member of the best
+// quarter, and multiplies each setting by 0.8 or 1.2. The members must all use
+// the same tables, so they share a learner and an exploration policy name.
+void trainPopulation(
+    const Args& args, const std::function<void(const Args&)>& runTrial);
+}